@@ -0,0 +1,96 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+#include "Transform.hpp"
+#include "TransformBatch.hpp"
+
+// Same layout as SceneDataBuffer::ObjectData.
+struct ObjectData {
+  alignas (16) glm::mat4 model;
+  alignas (16) glm::mat4 normalMatrix;
+};
+
+static const size_t TRANSFORMS_COUNT = 100000;
+static const int ITERATIONS = 50;
+
+/**
+ * @brief Runs func ITERATIONS times and returns the best time, in milliseconds.
+ */
+template <typename Func>
+static double measure(Func func)
+{
+  double best = 1e30;
+  for (int i = 0; i < ITERATIONS; i++) {
+    auto start = std::chrono::high_resolution_clock::now();
+    func();
+    auto end = std::chrono::high_resolution_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+  }
+
+  return best;
+}
+
+/**
+ * Builds the model and normal matrices of TRANSFORMS_COUNT moving transforms,
+ * first one by one through Transform, then with TransformBatch.
+ */
+int main()
+{
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<float> positions(-100.0f, 100.0f);
+  std::uniform_real_distribution<float> angles(-180.0f, 180.0f);
+  std::uniform_real_distribution<float> scales(0.5f, 2.0f);
+
+  std::vector<Transform> transforms(TRANSFORMS_COUNT);
+  for (Transform &transform : transforms) {
+    transform.setPosition(positions(generator), positions(generator), positions(generator));
+    transform.setRotation(angles(generator), angles(generator), angles(generator));
+    transform.setScale(scales(generator), scales(generator), scales(generator));
+  }
+
+  std::vector<ObjectData> objects(TRANSFORMS_COUNT);
+
+  // Every transform moves every frame, so the cached matrices never help.
+  double scalarTime = measure([&]() {
+    for (size_t i = 0; i < transforms.size(); i++) {
+      glm::vec3 position = transforms[i].getPosition();
+      transforms[i].setPosition(position.x, position.y, position.z);
+
+      objects[i].model        = transforms[i].getModelMatrix();
+      objects[i].normalMatrix = glm::mat4(transforms[i].getNormalMatrix());
+    }
+  });
+
+  TransformBatch batch;
+  batch.reserve(TRANSFORMS_COUNT);
+  double batchTime = measure([&]() {
+    batch.clear();
+    for (size_t i = 0; i < transforms.size(); i++) {
+      batch.add(static_cast<uint32_t>(i), transforms[i].getPosition(), transforms[i].getRotation(), transforms[i].getScale());
+    }
+    batch.computeMatrices(&objects[0].model[0][0], &objects[0].normalMatrix[0][0], sizeof(ObjectData) / sizeof(float));
+  });
+
+  // Checks the batch against Transform.
+  float maxError = 0.0f;
+  for (size_t i = 0; i < transforms.size(); i++) {
+    const glm::mat4 &model = transforms[i].getModelMatrix();
+    for (int column = 0; column < 4; column++) {
+      for (int row = 0; row < 4; row++) {
+        maxError = std::max(maxError, std::abs(model[column][row] - objects[i].model[column][row]));
+      }
+    }
+  }
+
+  std::cout << TRANSFORMS_COUNT << " transforms, best of " << ITERATIONS << " runs:\n";
+  std::cout << "  Transform::getModelMatrix(): " << scalarTime << " ms\n";
+  std::cout << "  TransformBatch (" << TransformBatch::getInstructionSetName() << "): " << batchTime << " ms ("
+            << scalarTime / batchTime << "x)\n";
+  std::cout << "  Max difference: " << maxError << "\n";
+
+  return 0;
+}
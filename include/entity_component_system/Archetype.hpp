@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+#include "ComponentType.hpp"
+#include "Pool.hpp"
+
+class Entity;
+
+/**
+ * @brief Storage of every entity that has exactly the same set of components.
+ *
+ * Entities are kept in fixed-size chunks. Inside a chunk each component type
+ * has its own tightly packed column, so iterating over one component type is
+ * a linear walk through memory. Rows are kept dense: removing an entity moves
+ * the last one into its place.
+ */
+class Archetype
+{
+public:
+  static constexpr std::size_t CHUNK_SIZE      = 16 * 1024; // In bytes.
+  static constexpr std::size_t CHUNK_ALIGNMENT = 64;        // Cache line.
+  static constexpr std::size_t CHUNKS_PER_BLOCK = 16;       // Chunks the pool requests at once.
+
+  struct alignas(CHUNK_ALIGNMENT) ChunkMemory {
+    std::byte data[CHUNK_SIZE];
+  };
+  // Shared by every archetype of a Manager, so a chunk freed by one archetype can be reused by any other.
+  using ChunksPool = Pool<ChunkMemory, CHUNKS_PER_BLOCK>;
+
+  Archetype(const ComponentBitSet &signature, ChunksPool &chunksPool);
+  ~Archetype();
+
+  Archetype(const Archetype&) = delete;
+  Archetype &operator=(const Archetype&) = delete;
+
+  // Appends a row for the entity. Its components are left uninitialized, the
+  // caller has to construct them.
+  std::size_t addRow(Entity* entity);
+  // Destroys the row's components and fills the hole with the last row.
+  // Returns the entity that was moved into the row, if any.
+  Entity* removeRow(std::size_t row);
+
+  void update(float deltaTime);
+  void draw();
+
+  // Getters and Setters
+
+  const ComponentBitSet &getSignature() const;
+  const std::vector<ComponentID> &getComponentIDs() const;
+  std::size_t getSize() const;
+  std::size_t getChunksCount() const;
+  std::size_t getChunkCapacity() const;
+  std::size_t getChunkSize(std::size_t chunkIndex) const;
+
+  void* getColumn(std::size_t chunkIndex, ComponentID id) const;
+  Entity** getEntities(std::size_t chunkIndex) const;
+  void* getComponent(std::size_t row, ComponentID id) const;
+  Entity* getEntity(std::size_t row) const;
+
+  template <typename T> T* getColumn(std::size_t chunkIndex) const
+  {
+    return static_cast<T*>(this->getColumn(chunkIndex, getComponentTypeID<T>()));
+  }
+
+private:
+  struct Chunk {
+    std::byte* data;
+    std::size_t count;
+  };
+
+  const ComponentBitSet signature;
+  ChunksPool &chunksPool;
+  std::vector<ComponentID> componentIDs;
+  std::vector<Chunk> chunks;
+  std::size_t size = 0;
+
+  // Layout shared by every chunk.
+  std::size_t chunkCapacity;
+  std::size_t chunkBytes;
+  std::array<std::size_t, maxComponents> columnOffsets{};
+
+  std::size_t computeLayout(std::size_t capacity);
+  std::byte* allocateChunk();
+  void freeChunk(std::byte* data);
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vector>
+#include <tuple>
+#include <utility>
+#include <functional>
+
+#include "ECS.hpp"
+
+/**
+ * @brief Records structural changes (spawning and destroying entities, adding
+ * and removing components) so they can be applied later, in one pass, at a
+ * point where nothing is iterating the archetypes.
+ *
+ * Each thread of the pool records into its own list, so recording never
+ * locks. Lists keep their capacity between frames.
+ */
+class CommandBuffer
+{
+public:
+  // threadsCount must cover every thread that records: the pool's workers plus the calling thread.
+  CommandBuffer(std::size_t threadsCount);
+
+  CommandBuffer(const CommandBuffer&) = delete;
+  CommandBuffer &operator=(const CommandBuffer&) = delete;
+
+  /**
+   * Records the creation of a new entity. init is called with the new entity
+   * on playback, where it can add the entity's components.
+   * Example of usage:
+   *         commands.spawn([](Entity &e) { e.addComponent<Transform>(); });
+   */
+  void spawn(std::function<void(Entity&)> init = {});
+  void destroy(EntityHandle handle);
+
+  /**
+   * Records the addition of a component. The arguments are copied now and
+   * forwarded to the component's constructor on playback.
+   * Example of usage:
+   *         commands.addComponent<Transform>(entity.getHandle(), glm::vec3(0.0f));
+   *
+   * @tparam T The type of component that you want to add.
+   */
+  template <typename T, typename... TArgs>
+  void addComponent(EntityHandle handle, TArgs&&... mArgs)
+  {
+    this->record({ Command::ADD_COMPONENT, handle, 0,
+      [args = std::make_tuple(std::forward<TArgs>(mArgs)...)](Entity &entity) mutable {
+        std::apply([&entity](auto&&... a) { entity.addComponent<T>(std::move(a)...); }, std::move(args));
+      } });
+  }
+
+  template <typename T> void removeComponent(EntityHandle handle)
+  {
+    this->record({ Command::REMOVE_COMPONENT, handle, getComponentTypeID<T>(), {} });
+  }
+
+  // Applies every recorded command, thread by thread in recording order, and clears them.
+  // Commands on entities that no longer exist are dropped.
+  void playback(Manager &manager);
+
+  bool isEmpty() const;
+
+private:
+  struct Command {
+    enum Type { SPAWN, DESTROY, ADD_COMPONENT, REMOVE_COMPONENT };
+
+    Type type;
+    EntityHandle handle;
+    ComponentID componentID;
+    std::function<void(Entity&)> apply;
+  };
+
+  std::vector<std::vector<Command>> threadsCommands;
+
+  void record(Command &&command);
+};
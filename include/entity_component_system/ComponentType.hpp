@@ -0,0 +1,98 @@
+#pragma once
+
+#include <bitset>
+#include <array>
+#include <new>
+#include <utility>
+#include <stdexcept>
+
+class Component;
+
+using ComponentID = std::size_t;
+inline ComponentID getComponentTypeID()
+{
+  static ComponentID lastID = 0;
+  return lastID++;
+}
+constexpr std::size_t maxComponents = 32;
+using ComponentBitSet = std::bitset<maxComponents>;
+using ComponentArray  = std::array<Component*, maxComponents>;
+
+/**
+ * Gets component's type ID.
+ *
+ * @exceptsafe Shall not throw execeptions.
+ * @param T
+ * @return Component type ID.
+ */
+template <typename T> inline ComponentID getComponentTypeID() noexcept
+{
+  static ComponentID typeID = getComponentTypeID();
+  return typeID;
+}
+
+/**
+ * @brief Type-erased operations over a component type. Archetypes store
+ * components by value in raw memory, so they use these to move, destroy and
+ * update them without knowing their types.
+ */
+struct ComponentTypeInfo
+{
+  std::size_t size      = 0;
+  std::size_t alignment = 0;
+
+  void (*moveConstruct)(void* dst, void* src) = nullptr;
+  void (*destroy)(void* component) = nullptr;
+
+  // Run over a whole column of components at once.
+  void (*update)(void* components, std::size_t count, float deltaTime) = nullptr;
+  void (*draw)(void* components, std::size_t count) = nullptr;
+};
+
+inline std::array<ComponentTypeInfo, maxComponents> &getComponentTypeInfos()
+{
+  static std::array<ComponentTypeInfo, maxComponents> componentTypeInfos;
+  return componentTypeInfos;
+}
+
+/**
+ * Registers the type-erased operations of a component type, the first time it
+ * is used.
+ *
+ * @tparam T The type of the component.
+ * @return Component type ID.
+ */
+template <typename T> ComponentID registerComponentType()
+{
+  ComponentID id = getComponentTypeID<T>();
+  if (id >= maxComponents) {
+    throw std::runtime_error("Error: Too many component types. Increase maxComponents.\n");
+  }
+
+  ComponentTypeInfo &info = getComponentTypeInfos()[id];
+  if (info.size != 0) {
+    return id;
+  }
+
+  info.size      = sizeof(T);
+  info.alignment = alignof(T);
+
+  info.moveConstruct = [](void* dst, void* src) {
+    new (dst) T(std::move(*static_cast<T*>(src)));
+  };
+  info.destroy = [](void* component) {
+    static_cast<T*>(component)->~T();
+  };
+
+  // The calls are qualified, so they aren't dispatched through the vtable.
+  info.update = [](void* components, std::size_t count, float deltaTime) {
+    T* column = static_cast<T*>(components);
+    for (std::size_t i = 0; i < count; i++) column[i].T::update(deltaTime);
+  };
+  info.draw = [](void* components, std::size_t count) {
+    T* column = static_cast<T*>(components);
+    for (std::size_t i = 0; i < count; i++) column[i].T::draw();
+  };
+
+  return id;
+}
@@ -6,31 +6,42 @@
 #include <algorithm>
 #include <bitset>
 #include <array>
+#include <unordered_map>
+#include <utility>
+#include <mutex>
+#include <cstdint>
+
+#include "ComponentType.hpp"
+#include "Archetype.hpp"
+#include "Pool.hpp"
 
 class Component;
 class Entity;
-
-using ComponentID = std::size_t;
-inline ComponentID getComponentTypeID()
-{
-  static ComponentID lastID = 0;
-  return lastID++; 
-}
-constexpr std::size_t maxComponents = 32;
-using ComponentBitSet = std::bitset<maxComponents>;
-using ComponentArray  = std::array<Component*, maxComponents>;
+class Manager;
 
 /**
- * Gets component's type ID.
- * 
- * @exceptsafe Shall not throw execeptions.
- * @param T 
- * @return Component type ID.
+ * @brief Weak reference to an entity: the index of its slot in the Manager plus
+ * the slot's generation. Slots are recycled, but their generation is bumped on
+ * every destruction, so handles to destroyed entities are detected in O(1).
  */
-template <typename T> inline ComponentID getComponentTypeID() noexcept
+struct EntityHandle
 {
-  static ComponentID typeID = getComponentTypeID();
-  return typeID;
+  uint32_t index      = 0;
+  uint32_t generation = 0; // Generations start at 1, so a default handle is never valid.
+
+  bool operator==(const EntityHandle &other) const
+  {
+    return index == other.index && generation == other.generation;
+  }
+  bool operator!=(const EntityHandle &other) const { return !(*this == other); }
+};
+
+namespace std {
+  template<> struct hash<EntityHandle> {
+    size_t operator()(EntityHandle const& handle) const {
+      return hash<uint64_t>()((static_cast<uint64_t>(handle.generation) << 32) | handle.index);
+    }
+  };
 }
 
 class Component
@@ -38,6 +49,11 @@ class Component
 public:
   Entity* entity;
 
+  Component() = default;
+  Component(const Component&) = default;
+  Component(Component&&) = default;
+  Component &operator=(const Component&) = default;
+  Component &operator=(Component&&) = default;
   virtual ~Component() = default;
 
   // virtual --means that the function can be override
@@ -46,23 +62,43 @@ public:
   virtual void draw() {}
 };
 
-class Component;
+/**
+ * @brief Handle to a set of components. The components themselves are stored
+ * by value in the Archetype that matches the entity's component set, so
+ * adding a component moves the entity to another archetype.
+ */
 class Entity
 {
 private:
   bool active = true;
-  std::vector<std::unique_ptr<Component>> componentsVec;
+  Manager* manager;
+  EntityHandle handle;
+
+  // Where the components are stored.
+  Archetype* archetype = nullptr;
+  std::size_t row = 0;
 
-  ComponentArray componentArray;
+  // Cached pointers into the archetype's columns. Refreshed whenever the entity's row moves.
+  ComponentArray componentArray{};
   ComponentBitSet componentBitSet;
 
+  void migrate(const ComponentBitSet &signature);
+  void detach();
+  void refreshComponentArray();
+
 public:
+  Entity(Manager* manager, EntityHandle handle);
+  ~Entity();
+
+  Entity(const Entity&) = delete;
+  Entity &operator=(const Entity&) = delete;
+
   void update(float deltaTime);
   void draw();
 
   /**
    * Gets the desired component of the game object giving the type of the component.
-   * Example of usage: 
+   * Example of usage:
    *         gameobject.getComponent<Transform>().position.x;
    *
    * @tparam T The type of the desired component.
@@ -89,42 +125,192 @@ public:
   }
 
   /**
-   * Adds a new component to the desired game object.
+   * Adds a new component to the desired game object. If the game object
+   * already has a component of the same type, it is replaced.
    * Example of usage:
    *         gameobject.addComponent<Transform>(new Vector2f(23.0f, 21.0f));
    *
    * @tparam T The type of component that you want to add.
    * @return the new component's pointer.
    */
-  template <typename T, typename... TArgs> 
+  template <typename T, typename... TArgs>
   T &addComponent(TArgs&&... mArgs)
   {
-    T* c(new T(std::forward<TArgs>(mArgs)...));
-    c->entity = this;
-    std::unique_ptr<Component> uPtr { c };
-    componentsVec.emplace_back(std::move(uPtr));
-
-    componentArray[getComponentTypeID<T>()] = c;
-    componentBitSet[getComponentTypeID<T>()] = true;
-            
+    ComponentID id = registerComponentType<T>();
+
+    // Built before touching the storage, so a throwing constructor leaves the entity untouched.
+    T component(std::forward<TArgs>(mArgs)...);
+    component.entity = this;
+
+    if (componentBitSet[id]) {
+      static_cast<T*>(componentArray[id])->~T();
+    }
+    else {
+      ComponentBitSet signature = componentBitSet;
+      signature[id] = true;
+      this->migrate(signature);
+    }
+
+    T* c = new (componentArray[id]) T(std::move(component));
     c->init();
 
-    return *c;         
+    return *c;
+  }
+
+  /**
+   * Removes a component from the desired game object. Nothing happens if the
+   * game object doesn't have it.
+   * Example of usage:
+   *         gameobject.removeComponent<Transform>();
+   *
+   * @tparam T The type of component that you want to remove.
+   */
+  template <typename T> void removeComponent()
+  {
+    this->removeComponent(getComponentTypeID<T>());
   }
+  void removeComponent(ComponentID id);
 
+  // Marks the entity to be destroyed on the next Manager::refresh().
   void pop();
 
   bool isActive();
+  EntityHandle getHandle() const;
+
+  friend class Manager;
+};
+
+/**
+ * @brief Every entity that has, at least, the components Ts. It walks the
+ * matching archetypes chunk by chunk, never touching the entities that don't
+ * match. Entities mustn't gain or lose components while they are iterated.
+ */
+template <typename... Ts>
+class View
+{
+private:
+  const std::vector<Archetype*> &archetypes;
+
+public:
+  View(const std::vector<Archetype*> &archetypes) : archetypes(archetypes) {}
+
+  /**
+   * Calls func once per chunk, with the chunk's columns of every requested component.
+   * Example of usage:
+   *         view.eachChunk([](Entity** entities, std::size_t count, Transform* transforms) { ... });
+   */
+  template <typename Func> void eachChunk(Func &&func) const
+  {
+    for (Archetype* archetype : archetypes) {
+      for (std::size_t chunk = 0; chunk < archetype->getChunksCount(); chunk++) {
+        func(archetype->getEntities(chunk), archetype->getChunkSize(chunk), archetype->template getColumn<Ts>(chunk)...);
+      }
+    }
+  }
+
+  /**
+   * Calls func once per entity, with a reference to each requested component.
+   * Example of usage:
+   *         view.each([](Entity &entity, Transform &transform) { ... });
+   */
+  template <typename Func> void each(Func &&func) const
+  {
+    this->eachChunk([&func](Entity** entities, std::size_t count, Ts*... columns) {
+      for (std::size_t i = 0; i < count; i++) func(*entities[i], columns[i]...);
+    });
+  }
+
+  std::size_t size() const
+  {
+    std::size_t count = 0;
+    for (Archetype* archetype : archetypes) count += archetype->getSize();
+    return count;
+  }
+
+  const std::vector<Archetype*> &getArchetypes() const
+  {
+    return this->archetypes;
+  }
 };
 
 class Manager
 {
 private:
-  std::vector<std::unique_ptr<Entity>> entitiesList;
+  static constexpr std::size_t ENTITIES_PER_BLOCK = 1024;
+
+  // Declared before the archetypes and the entities, so it outlives them.
+  Archetype::ChunksPool chunksPool;
+  std::unordered_map<ComponentBitSet, std::unique_ptr<Archetype>> archetypesMap;
+  std::vector<Archetype*> archetypesVec; // In creation order, so iteration is deterministic.
+  // Entity slots, addressed by EntityHandle::index. Destroyed slots are null
+  // until they are recycled from the free list.
+  std::vector<Entity*> entitiesSlots;
+  Pool<Entity, ENTITIES_PER_BLOCK> entitiesPool;
+  std::vector<uint32_t> generations;
+  std::vector<uint32_t> freeSlots;
+  std::vector<EntityHandle> poppedEntities;
+  std::size_t entitiesCount = 0;
+  uint64_t structureVersion = 0; // Bumped whenever an entity moves to another archetype row.
+
+  // Archetypes that match each query asked so far. Kept up to date as new archetypes are created.
+  std::unordered_map<ComponentBitSet, std::vector<Archetype*>> queriesCache;
+  // Systems running in parallel may ask for views at the same time.
+  std::mutex archetypesMutex;
+
+  const std::vector<Archetype*> &getMatchingArchetypes(const ComponentBitSet &query);
 
 public:
+  ~Manager();
+
   void update(float deltaTime);
   void draw();
+  // Destroys every popped entity.
   void refresh();
   Entity &addEntity();
-};
\ No newline at end of file
+  // Makes room for count more entities, so they can be added without reallocating.
+  void reserveEntities(std::size_t count);
+  void destroyEntity(EntityHandle handle);
+  bool isAlive(EntityHandle handle) const;
+
+  /**
+   * Gets every entity that has all the given components.
+   * Example of usage:
+   *         auto renderables = manager.view<Transform, ModelRenderer>();
+   *
+   * @tparam Ts The components that the entities must have.
+   * @return View over the matching entities.
+   */
+  template <typename... Ts> View<Ts...> view()
+  {
+    static const ComponentBitSet query = [] {
+      ComponentBitSet signature;
+      (signature.set(getComponentTypeID<Ts>()), ...);
+      return signature;
+    }();
+
+    return View<Ts...>(this->getMatchingArchetypes(query));
+  }
+
+  /**
+   * Calls func for every entity that has all the given components.
+   * Example of usage:
+   *         manager.each<Transform, ModelRenderer>([](Entity &e, Transform &t, ModelRenderer &m) { ... });
+   */
+  template <typename... Ts, typename Func> void each(Func &&func)
+  {
+    this->view<Ts...>().each(std::forward<Func>(func));
+  }
+
+  // Getters and Setters
+
+  // Returns nullptr if the handle's entity has been destroyed.
+  Entity* getEntity(EntityHandle handle) const;
+  std::size_t getEntitiesCount() const;
+  // Cached component pointers are only valid while this doesn't change.
+  uint64_t getStructureVersion() const;
+  // Prints how much of the entities' and chunks' pools is in use.
+  void printStats() const;
+  Archetype* getArchetype(const ComponentBitSet &signature);
+  const std::vector<Archetype*> &getArchetypes() const;
+  friend class Entity;
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vector>
+#include <new>
+#include <cstddef>
+#include <utility>
+
+/**
+ * @brief Slab allocator for objects of a single type. Memory is requested in
+ * blocks of BLOCK_SIZE objects, and freed slots are recycled through a free
+ * list, so creating and destroying objects is a couple of pointer writes and
+ * objects created together end up next to each other.
+ *
+ * Blocks are only given back when the pool is destroyed. Every object must be
+ * destroyed before that, the pool doesn't track which slots are alive.
+ */
+template <typename T, std::size_t BLOCK_SIZE>
+class Pool
+{
+private:
+  union Slot {
+    Slot* next;
+    alignas(T) std::byte storage[sizeof(T)];
+  };
+
+  std::vector<Slot*> blocks;
+  Slot* freeList = nullptr;
+  std::size_t size = 0;
+
+  void allocateBlock()
+  {
+    Slot* block = static_cast<Slot*>(::operator new(sizeof(Slot) * BLOCK_SIZE, std::align_val_t(alignof(Slot))));
+    blocks.push_back(block);
+
+    // Linked backwards, so the block's slots are handed out in address order.
+    for (std::size_t i = BLOCK_SIZE; i > 0; i--) {
+      block[i - 1].next = freeList;
+      freeList = &block[i - 1];
+    }
+  }
+
+public:
+  Pool() = default;
+  ~Pool()
+  {
+    for (Slot* block : blocks) {
+      ::operator delete(block, std::align_val_t(alignof(Slot)));
+    }
+  }
+
+  Pool(const Pool&) = delete;
+  Pool &operator=(const Pool&) = delete;
+
+  template <typename... TArgs>
+  T* create(TArgs&&... mArgs)
+  {
+    if (freeList == nullptr) this->allocateBlock();
+
+    // The object overwrites the link, so it has to be read first.
+    Slot* slot = freeList;
+    Slot* next = slot->next;
+    T* object = new (slot->storage) T(std::forward<TArgs>(mArgs)...);
+
+    freeList = next;
+    size++;
+    return object;
+  }
+
+  void destroy(T* object)
+  {
+    object->~T();
+
+    Slot* slot = reinterpret_cast<Slot*>(object);
+    slot->next = freeList;
+    freeList = slot;
+    size--;
+  }
+
+  // Getters and Setters
+
+  std::size_t getSize() const { return this->size; }
+  std::size_t getCapacity() const { return this->blocks.size() * BLOCK_SIZE; }
+  std::size_t getBlocksCount() const { return this->blocks.size(); }
+  std::size_t getReservedBytes() const { return this->blocks.size() * BLOCK_SIZE * sizeof(Slot); }
+};
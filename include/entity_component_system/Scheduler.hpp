@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+
+#include "System.hpp"
+#include "CommandBuffer.hpp"
+#include "ThreadPool.hpp"
+
+/**
+ * @brief Runs the registered systems every frame. Systems that don't touch the
+ * same components run in parallel; conflicting ones run in the order they were
+ * added.
+ */
+class Scheduler
+{
+private:
+  std::vector<std::unique_ptr<System>> systems;
+  ThreadPool &threadPool;
+  CommandBuffer commandBuffer;
+
+  // Dependency graph: dependents[i] holds the systems that must wait for system i.
+  std::vector<std::vector<size_t>> dependents;
+  std::vector<size_t> dependenciesCount;
+
+  void buildDependencyGraph();
+  void runSystems(Manager &manager, float deltaTime);
+
+public:
+  Scheduler(ThreadPool &threadPool);
+
+  /**
+   * Adds a new system to the scheduler.
+   * Example of usage:
+   *         scheduler.addSystem<TransformSystem>();
+   *
+   * @tparam T The type of the system.
+   * @return The new system.
+   */
+  template <typename T, typename... TArgs>
+  T &addSystem(TArgs&&... mArgs)
+  {
+    T* system = new T(std::forward<TArgs>(mArgs)...);
+    systems.emplace_back(system);
+    return *system;
+  }
+
+  // Runs every system and then applies the structural changes they recorded.
+  void update(Manager &manager, float deltaTime);
+
+  // Getters and Setters
+
+  CommandBuffer &getCommandBuffer();
+};
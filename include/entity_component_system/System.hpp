@@ -0,0 +1,74 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+
+#include "ECS.hpp"
+#include "CommandBuffer.hpp"
+#include "ThreadPool.hpp"
+
+/**
+ * @brief Logic that runs over the entities every frame. Each system declares
+ * which components it reads and writes, so the Scheduler knows which systems
+ * can run at the same time.
+ */
+class System
+{
+private:
+  std::string name;
+  ComponentBitSet readsBitSet;
+  ComponentBitSet writesBitSet;
+
+protected:
+  System(const std::string &name) : name(name) {}
+
+  template <typename... Ts> void reads()  { (readsBitSet.set(getComponentTypeID<Ts>()), ...); }
+  template <typename... Ts> void writes() { (writesBitSet.set(getComponentTypeID<Ts>()), ...); }
+
+  /**
+   * Splits the chunks of every entity that has the components Ts between the
+   * pool's threads, calling func(entities, count, columns...) for each chunk.
+   * Chunks are never shared between threads, so func doesn't need to lock.
+   */
+  template <typename... Ts, typename Func>
+  void parallelEachChunk(Manager &manager, ThreadPool &threadPool, Func func)
+  {
+    std::vector<std::pair<Archetype*, std::size_t>> chunks;
+    for (Archetype* archetype : manager.view<Ts...>().getArchetypes()) {
+      for (std::size_t chunk = 0; chunk < archetype->getChunksCount(); chunk++) {
+        chunks.push_back({ archetype, chunk });
+      }
+    }
+
+    // A few ranges per thread, so a slow chunk doesn't hold the others back.
+    std::size_t grainSize = chunks.size() / ((threadPool.getThreadsCount() + 1) * 4) + 1;
+    threadPool.parallelFor(chunks.size(), grainSize, [&chunks, &func](std::size_t begin, std::size_t end) {
+      for (std::size_t i = begin; i < end; i++) {
+        Archetype* archetype = chunks[i].first;
+        std::size_t chunk = chunks[i].second;
+        func(archetype->getEntities(chunk), archetype->getChunkSize(chunk), archetype->template getColumn<Ts>(chunk)...);
+      }
+    });
+  }
+
+public:
+  virtual ~System() = default;
+
+  // Must not add or remove components directly, other systems may be iterating the same
+  // archetypes. Structural changes go through commands, which are applied after every system ran.
+  virtual void update(Manager &manager, CommandBuffer &commands, ThreadPool &threadPool, float deltaTime) = 0;
+
+  // Two systems conflict if one of them writes a component that the other one reads or writes.
+  bool conflictsWith(const System &other) const
+  {
+    return (writesBitSet & (other.readsBitSet | other.writesBitSet)).any() ||
+           (other.writesBitSet & readsBitSet).any();
+  }
+
+  // Getters and Setters
+
+  const std::string &getName() const { return this->name; }
+  const ComponentBitSet &getReads() const { return this->readsBitSet; }
+  const ComponentBitSet &getWrites() const { return this->writesBitSet; }
+};
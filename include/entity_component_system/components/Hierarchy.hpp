@@ -0,0 +1,35 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "ECS.hpp"
+
+/**
+ * @brief Attaches the entity to a parent entity, so the entity's Transform is
+ * relative to its parent's. The world matrices are kept up to date by the
+ * HierarchySystem.
+ */
+class Hierarchy : public Component
+{
+private:
+  EntityHandle parent;
+
+  // Written by the HierarchySystem.
+  glm::mat4 worldMatrix       = glm::mat4{1.0f};
+  glm::mat3 worldNormalMatrix = glm::mat3{1.0f};
+  uint32_t worldVersion = 1; // Bumped every time the world matrices change.
+
+  friend class HierarchySystem;
+
+public:
+  Hierarchy(EntityHandle parent);
+  Hierarchy();
+
+  // Getters and Setters
+
+  EntityHandle getParent() const;
+  void setParent(EntityHandle parent);
+  const glm::mat4 &getWorldMatrix() const;
+  const glm::mat3 &getWorldNormalMatrix() const;
+  uint32_t getWorldVersion() const;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <cstdint>
+
+#include "System.hpp"
+#include "Transform.hpp"
+#include "Hierarchy.hpp"
+
+/**
+ * @brief Propagates the world matrices down the Hierarchy components.
+ *
+ * Nodes are kept sorted by depth, so every parent is updated before its
+ * children and each depth level can be split between the pool's threads.
+ * Only nodes whose Transform changed, or whose parent's world matrix changed,
+ * are recomputed. The sorted nodes are rebuilt when entities move between
+ * archetypes or a node changes its parent.
+ */
+class HierarchySystem : public System
+{
+public:
+  static constexpr std::size_t GRAIN_SIZE = 1024; // Nodes per task.
+
+  HierarchySystem();
+
+  void update(Manager &manager, CommandBuffer &commands, ThreadPool &threadPool, float deltaTime) override;
+
+private:
+  struct Node {
+    EntityHandle parent;
+    Transform* transform;
+    Hierarchy* hierarchy;
+    int32_t parentNode;     // Index of the parent in nodes, or -1 if the parent isn't a node.
+    int32_t rootIndex;      // Index in roots when the parent isn't a node, or -1 if there's no parent at all.
+    uint32_t localVersion;  // Transform version the world matrix was computed with.
+  };
+
+  // Parents without a Hierarchy. Their model matrix is their world matrix.
+  struct Root {
+    Transform* transform;
+    glm::mat4 modelMatrix;
+    uint32_t version;
+  };
+
+  std::vector<Node> nodes;               // Sorted by depth.
+  std::vector<std::size_t> levelsOffsets; // Nodes of depth d are in [levelsOffsets[d], levelsOffsets[d + 1]).
+  std::vector<Root> roots;
+  std::vector<uint8_t> rootsChanged;
+  std::vector<uint8_t> nodesChanged;
+
+  uint64_t structureVersion = UINT64_MAX;
+  std::atomic<bool> parentsChanged{false};
+
+  void rebuild(Manager &manager);
+  void propagate(ThreadPool &threadPool);
+  void updateNode(std::size_t index);
+};
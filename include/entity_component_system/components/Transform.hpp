@@ -10,7 +10,16 @@ private:
   glm::vec3 position;
   glm::vec3 scaleVec = glm::vec3{1.0f};
   glm::vec3 rotation = glm::vec3(0.0f, 0.0f, 0.0f);
+
+  // Cache
+  // Rebuilt lazily, only after the position, rotation or scale change.
+  glm::mat4 modelMatrix  = glm::mat4{1.0f};
   glm::mat3 normalMatrix = glm::mat3{1.0f};
+  bool dirty = true;
+  uint32_t version = 1; // Bumped on every change, so users of the matrices know when to refresh their copies.
+
+  void markDirty();
+  void rebuildMatrices();
 
 public:  
   Transform(glm::vec3 position);
@@ -28,8 +37,9 @@ public:
   glm::mat4 getTranslationMatrix();
   glm::mat4 getRotationMatrix();
   glm::mat4 getScaleMatrix();
-  glm::mat3 getNormalMatrix();
-  glm::mat4 getModelMatrix();
+  const glm::mat3 &getNormalMatrix();
+  const glm::mat4 &getModelMatrix();
+  uint32_t getVersion() const;
 
   // Encapsulation.
   const glm::vec3 getPosition();
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+/**
+ * @brief Builds the model and normal matrices of many transforms at once.
+ * Transforms are gathered as structure of arrays and processed 8 (AVX2) or 4
+ * (SSE) at a time, picking the widest instruction set the CPU supports at
+ * runtime. Matrices match Transform::getModelMatrix() and getNormalMatrix().
+ */
+class TransformBatch
+{
+public:
+  enum class InstructionSet { SCALAR, SSE, AVX2 };
+
+  void clear();
+  void reserve(std::size_t count);
+
+  // Queues a transform whose matrices go to the target-th element of the output.
+  void add(uint32_t target, const glm::vec3 &position, const glm::vec3 &rotation, const glm::vec3 &scale);
+
+  /**
+   * Writes the matrices of every queued transform. The model matrix of the
+   * transform queued with target t goes to models + t * stride, and its
+   * normal matrix, as a mat4, to normals + t * stride.
+   *
+   * @param stride Distance between consecutive outputs, in floats.
+   */
+  void computeMatrices(float* models, float* normals, std::size_t stride) const;
+
+  // Getters and Setters
+
+  std::size_t getSize() const;
+  static InstructionSet getInstructionSet();
+  static const char* getInstructionSetName();
+
+private:
+  std::vector<float> positions[3];
+  std::vector<float> rotations[3];
+  std::vector<float> scales[3];
+  std::vector<uint32_t> targets;
+};
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// The SSE and AVX2 kernels are only built for 64-bit x86, where SSE2 is always available.
+#if defined(__x86_64__) || defined(_M_X64)
+  #define TRANSFORM_BATCH_X86
+#endif
+
+/**
+ * @brief Inputs and outputs of a TransformBatch kernel. Transforms are read as
+ * structure of arrays and the matrices are written, column-major, to
+ * models + targets[i] * stride and normals + targets[i] * stride.
+ */
+struct TransformBatchData
+{
+  const float* position[3];
+  const float* rotation[3]; // Euler angles, in degrees.
+  const float* scale[3];
+  const uint32_t* targets;
+  std::size_t count;
+
+  float* models;
+  float* normals;
+  std::size_t stride; // In floats.
+};
+
+// Each one processes the transforms in [0, count), rounded down to its width, and returns how many it did.
+std::size_t computeMatricesSSE(const TransformBatchData &data);
+std::size_t computeMatricesAVX2(const TransformBatchData &data);
+
+/**
+ * The kernel shared by every instruction set. Ops wraps the vector type and
+ * the intrinsics of one instruction set, processing Ops::WIDTH transforms at
+ * a time. Only meant to be included by the TransformBatch source files.
+ *
+ * Builds the same matrices as Transform: model = T * S * R, with R built from
+ * the Euler angles through a quaternion, like glm::quat(eulerAngles) does. The
+ * normal matrix is transpose(inverse(S * R)), which for a rotation R is just
+ * inverse(S) * R, so no general 3x3 inverse is needed.
+ */
+namespace TransformBatchKernel
+{
+  template <typename Ops>
+  inline void sinCos(typename Ops::Float x, typename Ops::Float &sin, typename Ops::Float &cos)
+  {
+    using Float = typename Ops::Float;
+    using Int   = typename Ops::Int;
+
+    // x = r + quadrant * pi/2, with r in [-pi/4, pi/4]. pi/2 is split in three
+    // parts so the reduction doesn't lose precision (Cody-Waite).
+    Int quadrant = Ops::toInt(Ops::mul(x, Ops::set(0.63661977236f)));
+    Float q = Ops::toFloat(quadrant);
+    Float r = Ops::sub(x, Ops::mul(q, Ops::set(1.5703125f)));
+    r = Ops::sub(r, Ops::mul(q, Ops::set(4.837512969970703125e-4f)));
+    r = Ops::sub(r, Ops::mul(q, Ops::set(7.549789948768648e-8f)));
+
+    // Minimax polynomials on [-pi/4, pi/4].
+    Float r2 = Ops::mul(r, r);
+    Float sinR = Ops::add(Ops::mul(r2, Ops::set(-1.9515295891e-4f)), Ops::set(8.3321608736e-3f));
+    sinR = Ops::add(Ops::mul(sinR, r2), Ops::set(-1.6666654611e-1f));
+    sinR = Ops::add(Ops::mul(Ops::mul(sinR, r2), r), r);
+
+    Float cosR = Ops::add(Ops::mul(r2, Ops::set(2.443315711809948e-5f)), Ops::set(-1.388731625493765e-3f));
+    cosR = Ops::add(Ops::mul(cosR, r2), Ops::set(4.166664568298827e-2f));
+    cosR = Ops::mul(Ops::mul(cosR, r2), r2);
+    cosR = Ops::add(Ops::sub(cosR, Ops::mul(r2, Ops::set(0.5f))), Ops::set(1.0f));
+
+    // Odd quadrants swap sin and cos, and each one has its own signs.
+    Float swap    = Ops::bitTest(quadrant, 1);
+    Float sinSign = Ops::bitTest(quadrant, 2);
+    Float cosSign = Ops::bitTest(Ops::addInt(quadrant, 1), 2);
+
+    sin = Ops::negateIf(Ops::select(swap, cosR, sinR), sinSign);
+    cos = Ops::negateIf(Ops::select(swap, sinR, cosR), cosSign);
+  }
+
+  template <typename Ops>
+  inline void computeMatrices(const TransformBatchData &data, std::size_t first)
+  {
+    using Float = typename Ops::Float;
+
+    Float position[3], scale[3], sin[3], cos[3];
+    for (int axis = 0; axis < 3; axis++) {
+      position[axis] = Ops::load(data.position[axis] + first);
+      scale[axis]    = Ops::load(data.scale[axis] + first);
+
+      // Half angles, in radians.
+      Float halfAngle = Ops::mul(Ops::load(data.rotation[axis] + first), Ops::set(0.00872664626f));
+      sinCos<Ops>(halfAngle, sin[axis], cos[axis]);
+    }
+
+    // Quaternion from the Euler angles.
+    Float cc = Ops::mul(cos[1], cos[2]), ss = Ops::mul(sin[1], sin[2]);
+    Float sc = Ops::mul(sin[1], cos[2]), cs = Ops::mul(cos[1], sin[2]);
+    Float qw = Ops::add(Ops::mul(cos[0], cc), Ops::mul(sin[0], ss));
+    Float qx = Ops::sub(Ops::mul(sin[0], cc), Ops::mul(cos[0], ss));
+    Float qy = Ops::add(Ops::mul(cos[0], sc), Ops::mul(sin[0], cs));
+    Float qz = Ops::sub(Ops::mul(cos[0], cs), Ops::mul(sin[0], sc));
+
+    // Rotation matrix, rotation[column][row].
+    Float one = Ops::set(1.0f), two = Ops::set(2.0f);
+    Float xx = Ops::mul(qx, qx), yy = Ops::mul(qy, qy), zz = Ops::mul(qz, qz);
+    Float xy = Ops::mul(qx, qy), xz = Ops::mul(qx, qz), yz = Ops::mul(qy, qz);
+    Float wx = Ops::mul(qw, qx), wy = Ops::mul(qw, qy), wz = Ops::mul(qw, qz);
+
+    Float rotation[3][3] = {
+      { Ops::sub(one, Ops::mul(two, Ops::add(yy, zz))), Ops::mul(two, Ops::add(xy, wz)), Ops::mul(two, Ops::sub(xz, wy)) },
+      { Ops::mul(two, Ops::sub(xy, wz)), Ops::sub(one, Ops::mul(two, Ops::add(xx, zz))), Ops::mul(two, Ops::add(yz, wx)) },
+      { Ops::mul(two, Ops::add(xz, wy)), Ops::mul(two, Ops::sub(yz, wx)), Ops::sub(one, Ops::mul(two, Ops::add(xx, yy))) },
+    };
+
+    Float inverseScale[3];
+    for (int axis = 0; axis < 3; axis++) inverseScale[axis] = Ops::div(one, scale[axis]);
+
+    // Vectors hold one element for WIDTH transforms. Stored here and then
+    // copied to each transform's destination, which is not contiguous.
+    alignas(32) float model[12][Ops::WIDTH];
+    alignas(32) float normal[9][Ops::WIDTH];
+    for (int column = 0; column < 3; column++) {
+      for (int row = 0; row < 3; row++) {
+        Ops::store(model[column * 3 + row], Ops::mul(rotation[column][row], scale[row]));
+        Ops::store(normal[column * 3 + row], Ops::mul(rotation[column][row], inverseScale[row]));
+      }
+    }
+    for (int axis = 0; axis < 3; axis++) Ops::store(model[9 + axis], position[axis]);
+
+    for (std::size_t lane = 0; lane < Ops::WIDTH; lane++) {
+      std::size_t target = static_cast<std::size_t>(data.targets[first + lane]) * data.stride;
+      float* modelOut  = data.models + target;
+      float* normalOut = data.normals + target;
+
+      for (int column = 0; column < 3; column++) {
+        modelOut[column * 4 + 0]  = model[column * 3 + 0][lane];
+        modelOut[column * 4 + 1]  = model[column * 3 + 1][lane];
+        modelOut[column * 4 + 2]  = model[column * 3 + 2][lane];
+        modelOut[column * 4 + 3]  = 0.0f;
+        normalOut[column * 4 + 0] = normal[column * 3 + 0][lane];
+        normalOut[column * 4 + 1] = normal[column * 3 + 1][lane];
+        normalOut[column * 4 + 2] = normal[column * 3 + 2][lane];
+        normalOut[column * 4 + 3] = 0.0f;
+      }
+
+      modelOut[12]  = model[9][lane];
+      modelOut[13]  = model[10][lane];
+      modelOut[14]  = model[11][lane];
+      modelOut[15]  = 1.0f;
+      normalOut[12] = 0.0f;
+      normalOut[13] = 0.0f;
+      normalOut[14] = 0.0f;
+      normalOut[15] = 1.0f;
+    }
+  }
+
+  template <typename Ops>
+  inline std::size_t computeMatrices(const TransformBatchData &data)
+  {
+    std::size_t count = data.count - data.count % Ops::WIDTH;
+    for (std::size_t first = 0; first < count; first += Ops::WIDTH) {
+      computeMatrices<Ops>(data, first);
+    }
+
+    return count;
+  }
+}
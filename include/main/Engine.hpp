@@ -5,6 +5,8 @@
 #include "Window.hpp"
 #include "Renderer.hpp"
 #include "ECS.hpp"
+#include "Scheduler.hpp"
+#include "ThreadPool.hpp"
 
 class Engine
 {
@@ -13,6 +15,9 @@ public:
 
   // TODO: Make this private when tests end.
   Manager entitiesManager;
+  ThreadPool threadPool;
+  // Systems run here after the components have been updated.
+  Scheduler scheduler;
 
 private:
   Entity &camera;
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+
+#include "MemoryAllocator.hpp"
+
+/**
+ * @brief Hierarchical-Z buffer built from the depth buffer after each frame.
+ *
+ * Each texel of a level keeps the farthest depth of the 2x2 texels below it,
+ * and the first level halves the depth buffer itself. The size is rounded up
+ * to a power of two, so a texel of level k covers exactly 2^(k+1) pixels of
+ * the depth buffer on each axis. The next frame's culling tests the objects
+ * against it, with the camera the depth was rendered with.
+ */
+class DepthPyramid
+{
+public:
+  // Without a depth image view, the pyramid can be bound but is never built.
+  DepthPyramid(VkDevice device, MemoryAllocator &allocator, VkQueue graphicsQueue, VkCommandPool commandPool,
+               VkPipelineCache pipelineCache, VkImageView depthImageView, VkExtent2D depthExtent,
+               VkSampleCountFlagBits depthSamples);
+  ~DepthPyramid();
+
+  // Records the reduction of the depth buffer. Must be recorded after the render pass, and only with a depth image view.
+  void record(VkCommandBuffer commandBuffer, const glm::mat4 &viewProj);
+
+  // Getters and Setters
+
+  VkImageView getImageView();
+  VkSampler getSampler();
+  VkExtent2D getDepthExtent();
+  uint32_t getLevelsCount();
+  // The view-projection of the depth the pyramid was last built from.
+  const glm::mat4 &getViewProj() const;
+  // False until the pyramid is built once, so its contents mean nothing yet.
+  bool isBuilt() const;
+
+private:
+  static constexpr uint32_t WORKGROUP_SIZE = 8; // Must match local_size_x and local_size_y of the shaders.
+  static inline const std::string SHADER_FILEPATH       = "shaders/depth_pyramid_compute_shader.spv";
+  static inline const std::string MSAA_SHADER_FILEPATH  = "shaders/depth_pyramid_msaa_compute_shader.spv";
+
+  VkImage image;
+  MemoryAllocator::Allocation imageAllocation;
+  VkImageView imageView;               // Every level, for the culling.
+  std::vector<VkImageView> levelsViews; // One per level, to build it.
+  VkSampler sampler;
+  VkExtent2D extent;      // Of the first level.
+  VkExtent2D depthExtent;
+  uint32_t levelsCount;
+  uint32_t depthSamplesCount;
+
+  VkDescriptorSetLayout descriptorSetLayout;
+  VkDescriptorPool descriptorPool;
+  std::vector<VkDescriptorSet> descriptorSets; // One per level.
+  VkPipelineLayout pipelineLayout;
+  VkPipeline depthPipeline;  // Reads the depth buffer into the first level.
+  VkPipeline reducePipeline; // Reads each of the other levels from the previous one.
+
+  glm::mat4 viewProj{1.0f};
+  bool built = false;
+
+  // Cache
+  VkDevice cachedDevice;
+  MemoryAllocator &cachedAllocator;
+
+  void createImage(VkQueue graphicsQueue, VkCommandPool commandPool);
+  void createDescriptorSets(VkImageView depthImageView);
+  void createPipelines(VkPipelineCache pipelineCache);
+  VkPipeline createPipeline(VkPipelineCache pipelineCache, const std::string &shaderFilepath);
+};
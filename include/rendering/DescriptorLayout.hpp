@@ -5,28 +5,23 @@
 
 #include "Shader.hpp"
 #include "Texture.hpp"
-#include "Pipeline.hpp"
 
-class Pipeline;
+/**
+ * @brief Owns the VkDescriptorSetLayout of a pipeline. The descriptor pools and
+ * sets themselves are per-object data, so they live in RenderObject.
+ */
 class DescriptorLayout
 {
 public:
   DescriptorLayout(VkDevice device);
   ~DescriptorLayout();
 
-  void createDescriptorPool();
-  void createDescriptorSets(Pipeline* pipeline, Texture* texture);
-  void bind(Pipeline* pipeline, VkCommandBuffer commandBuffer);
-
   // Getters and Setters
 
   VkDescriptorSetLayout getDescriptorSetLayout();
   const VkDescriptorSetLayout *getDescriptorSetLayoutPointer();
 
 private:
-  std::vector<VkDescriptorSet> descriptorSets;
-
-  VkDescriptorPool descriptorPool;
   VkDescriptorSetLayout descriptorSetLayout;
 
   void createDescriptorSetLayout(VkDevice device);
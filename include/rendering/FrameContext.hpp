@@ -0,0 +1,33 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <array>
+
+class PerspectiveCamera;
+
+/**
+ * @brief Snapshot of the camera for the frame being rendered. It is built once
+ * per frame, right after the entities have been updated, and everything that
+ * renders reads from it instead of querying the camera again.
+ */
+struct FrameContext
+{
+  // Windows headers define NEAR and FAR as macros, hence the suffix.
+  enum FrustumPlane { LEFT_PLANE = 0, RIGHT_PLANE, BOTTOM_PLANE, TOP_PLANE, NEAR_PLANE, FAR_PLANE };
+
+  glm::mat4 view{1.0f};
+  glm::mat4 proj{1.0f};
+  glm::mat4 viewProj{1.0f};
+  glm::vec3 cameraPosition{0.0f};
+  // Pixels covered by one world unit facing the camera at a distance of one unit.
+  float projectionScale = 1.0f;
+
+  // Normalized planes in world space, as (normal, distance). Points inside the
+  // frustum give a positive distance to every plane.
+  std::array<glm::vec4, 6> frustumPlanes;
+
+  void update(PerspectiveCamera &camera, float aspectRatio, float viewportHeight);
+
+private:
+  void extractFrustumPlanes();
+};
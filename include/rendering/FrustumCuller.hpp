@@ -0,0 +1,48 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+#include "Model.hpp"
+#include "FrameContext.hpp"
+#include "ThreadPool.hpp"
+
+/**
+ * @brief Tests the bounding sphere of every object of the scene against the
+ * camera's frustum, once per frame, before the commands are recorded.
+ *
+ * World-space spheres are kept as a structure of arrays, so four of them are
+ * tested at once with SSE. They are only recomputed for the objects whose
+ * matrices changed, and the test itself is split between the pool's threads.
+ */
+class FrustumCuller
+{
+public:
+  static constexpr std::size_t GRAIN_SIZE = 4096; // Objects per task. Must be a multiple of 4.
+
+  void resize(std::size_t count);
+  void setLocalBounds(std::size_t object, const Model::Bounds &bounds);
+  void updateWorldBounds(std::size_t object, const glm::mat4 &modelMatrix);
+  // The object is culled until its world bounds are updated again.
+  void hide(std::size_t object);
+  void cull(const FrameContext &frameContext, ThreadPool &threadPool);
+
+  // Getters and Setters
+
+  // Result of the last cull().
+  bool isVisible(std::size_t object) const;
+  // Center and radius of the object's sphere in world space.
+  glm::vec4 getWorldSphere(std::size_t object) const;
+
+private:
+  std::vector<glm::vec3> localCenters;
+  std::vector<float> localRadii;
+
+  // Padded to a multiple of 4. The padding has a negative infinite radius, so it's never visible.
+  std::vector<float> centersX, centersY, centersZ;
+  std::vector<float> radii;
+  std::vector<uint8_t> visible;
+
+  void cullRange(const FrameContext &frameContext, std::size_t begin, std::size_t end);
+};
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <map>
+#include <functional>
+#include <cstdint>
+
+#include "MemoryAllocator.hpp"
+#include "UploadBatch.hpp"
+
+/**
+ * @brief A few big device local buffers holding the vertices and indices of
+ * every model. Each model only keeps its ranges in them, so consecutive models
+ * don't bind any other buffer and their draws are told apart by vertexOffset
+ * and firstIndex.
+ *
+ * There is one arena per usage and element size, e.g. one for the full
+ * vertices and another for the 16-bit indices. Ranges are placed at the first
+ * hole they fit in, and freed ranges merge back with the holes around them.
+ * When an arena runs out of room, its live ranges are packed into a new
+ * buffer, bigger if they still wouldn't fit.
+ */
+class GeometryPool
+{
+public:
+  enum class Usage {
+    VERTICES,
+    INDICES
+  };
+
+  // Range of an arena. Where the range starts may change whenever its arena is packed.
+  struct Allocation {
+    uint32_t arena = UINT32_MAX;
+    uint32_t range = UINT32_MAX;
+
+    bool isValid() const;
+  };
+
+  // Buffers bound to a command buffer, so models sharing them don't bind them again.
+  struct Bindings {
+    VkBuffer vertexBuffer = VK_NULL_HANDLE;
+    VkBuffer indexBuffer  = VK_NULL_HANDLE;
+    VkIndexType indexType = VK_INDEX_TYPE_MAX_ENUM;
+  };
+
+  // Size the buffer of each arena starts with.
+  static constexpr VkDeviceSize ARENA_SIZE = 16 * 1024 * 1024;
+
+  GeometryPool(VkDevice device, MemoryAllocator &allocator, UploadBatch &uploadBatch);
+  ~GeometryPool();
+
+  // Uploads count elements of elementSize bytes into a new range. The copy is recorded into the upload batch.
+  Allocation allocate(Usage usage, uint32_t elementSize, const void* data, uint32_t count);
+  // Same, but write fills the staging memory itself, so the elements don't have to be built somewhere else first.
+  Allocation allocate(Usage usage, uint32_t elementSize, uint32_t count, const std::function<void(void*)> &write);
+  void free(Allocation allocation);
+
+  /**
+   * @brief Packs the live ranges of every arena with holes at its start, so
+   * the space freed by streamed out models can hold bigger ranges again.
+   * Waits for the GPU to finish with the old buffers.
+   *
+   * @return True if any range moved.
+   */
+  bool compact();
+  void printStats();
+
+  // Getters and Setters
+
+  VkBuffer getBuffer(Allocation allocation) const;
+  uint32_t getOffset(Allocation allocation) const; // In elements.
+  uint32_t getCount(Allocation allocation) const;
+  // Bumped whenever ranges move, so offsets copied somewhere else (e.g. indirect draws) can be refreshed.
+  uint32_t getGeneration() const;
+
+private:
+  struct Range {
+    uint32_t offset; // In elements.
+    uint32_t count;
+    bool live;
+  };
+
+  struct Arena {
+    Usage usage;
+    uint32_t elementSize;
+    uint32_t capacity = 0; // In elements.
+    uint32_t usedCount = 0;
+    VkBuffer buffer = VK_NULL_HANDLE;
+    MemoryAllocator::Allocation bufferAllocation;
+    std::vector<Range> ranges;
+    std::vector<uint32_t> unusedRanges; // Entries of ranges that were freed and can be reused.
+    std::map<uint32_t, uint32_t> holes; // Count of free elements at each offset.
+  };
+
+  std::vector<Arena> arenas;
+  uint32_t generation = 0;
+  bool rangesFreed = false; // Since the last upload, whose hole an unsubmitted copy may still be writing to.
+
+  // Cache
+  VkDevice cachedDevice;
+  MemoryAllocator &cachedAllocator;
+  UploadBatch &cachedUploadBatch;
+
+  Arena &findArena(Usage usage, uint32_t elementSize, uint32_t &arenaIndex);
+  void createBuffer(const Arena &arena, uint32_t capacity, VkBuffer &buffer, MemoryAllocator::Allocation &bufferAllocation);
+  bool takeHole(Arena &arena, uint32_t count, uint32_t &offset);
+  void addHole(Arena &arena, uint32_t offset, uint32_t count);
+  void relocate(Arena &arena, uint32_t capacity);
+  void upload(const Arena &arena, uint32_t offset, uint32_t count, const std::function<void(void*)> &write);
+};
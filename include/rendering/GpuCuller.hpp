@@ -0,0 +1,123 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+
+#include "Model.hpp"
+#include "FrameContext.hpp"
+#include "SceneDataBuffer.hpp"
+#include "DepthPyramid.hpp"
+
+/**
+ * @brief Culls the objects of the scene with a compute shader and builds one
+ * VkDrawIndexedIndirectCommand per draw, so the CPU never looks at the
+ * objects while recording.
+ *
+ * The shader reads the objects' matrices from the SceneDataBuffer and writes
+ * the visible objects to its instances, packed at the start of each draw's
+ * range, bumping the draw's instanceCount as it goes.
+ *
+ * Objects inside the frustum can also be tested against the previous frame's
+ * DepthPyramid, which culls the ones hidden behind what was drawn then.
+ *
+ * Each object also picks its level of detail, the same way Model::selectLod()
+ * does, and is written to that level's draw. The level each object picked is
+ * kept on the GPU for the next frame's hysteresis.
+ */
+class GpuCuller
+{
+public:
+  static constexpr uint32_t WORKGROUP_SIZE = 64; // Must match local_size_x of the shader.
+
+  // Laid out following std430.
+  struct CullData {
+    alignas (16) glm::vec4 sphere;    // Model space center and radius. A negative radius hides the object.
+    alignas (16) glm::vec4 lodErrors; // Model::Lod::error of each level of detail.
+    uint32_t firstDraw;               // Draw of the first level of detail. The others follow it.
+    uint32_t lodsCount;
+    uint32_t padding[2];
+  };
+  static_assert(Model::MAX_LODS == 4, "CullData::lodErrors holds a vec4.");
+
+  // Laid out following std140.
+  struct CullParams {
+    alignas (16) glm::vec4 frustumPlanes[6];
+    alignas (16) glm::mat4 pyramidViewProj; // Camera the depth pyramid was built with.
+    alignas (16) glm::ivec2 depthSize;
+    int32_t pyramidLevelsCount;
+    uint32_t objectsCount;
+    uint32_t occlusionCulling;
+    alignas (16) glm::vec3 cameraPosition;
+    float projectionScale;
+  };
+
+  // Objects culled by the shader, counted again every frame.
+  struct CullStats {
+    uint32_t frustumCulled;
+    uint32_t occlusionCulled;
+    uint32_t trianglesDrawn;
+    uint32_t trianglesSaved; // By drawing coarser levels of detail than the full meshes.
+  };
+
+  GpuCuller(VkDevice device, VkPhysicalDevice physicalDevice, MemoryAllocator &allocator,
+            VkPipelineCache pipelineCache, SceneDataBuffer* sceneDataBuffer, uint32_t drawsCount);
+  ~GpuCuller();
+
+  // Each frame's culls get the change when the frame is recorded, since the GPU may still be reading the others.
+  void setObject(uint32_t object, const Model &model, uint32_t firstDraw);
+  void setDraw(uint32_t drawIndex, const Model &model, uint32_t lod, uint32_t firstInstance);
+  // The object is never drawn again. Same as setObject().
+  void hide(uint32_t object);
+  // Records the culling dispatch. Must be recorded before the render pass begins.
+  void record(VkCommandBuffer commandBuffer, uint32_t currentFrame, const FrameContext &frameContext, bool occlusionCulling);
+
+  // Getters and Setters
+
+  // Must be set before recording, and again whenever the pyramid is recreated.
+  void setDepthPyramid(DepthPyramid* depthPyramid);
+  VkBuffer getDrawsBuffer(uint32_t currentFrame);
+  VkDeviceSize getDrawOffset(uint32_t drawIndex);
+  // Stats of the last frame whose culling has finished on the GPU.
+  const CullStats &getStats() const;
+
+private:
+  static inline const std::string SHADER_FILEPATH = "shaders/cull_compute_shader.spv";
+
+  std::vector<VkBuffer> cullsBuffers;
+  std::vector<MemoryAllocator::Allocation> cullsBuffersAllocations;
+  std::vector<CullData*> cullsMapped;
+  // Latest data of every object, and the objects each frame's culls are missing.
+  std::vector<CullData> culls;
+  std::vector<std::vector<uint32_t>> pendingCulls;
+  std::vector<VkBuffer> drawsBuffers; // The frame's CullStats follow the draws.
+  std::vector<MemoryAllocator::Allocation> drawsBuffersAllocations;
+  std::vector<VkDrawIndexedIndirectCommand*> drawsMapped;
+  std::vector<CullStats*> statsMapped;
+  std::vector<VkBuffer> paramsBuffers;
+  std::vector<MemoryAllocator::Allocation> paramsBuffersAllocations;
+  std::vector<CullParams*> paramsMapped;
+  // Level of detail of each object, read and written by every frame's culling.
+  VkBuffer lodsBuffer;
+  MemoryAllocator::Allocation lodsBufferAllocation;
+  VkDeviceSize statsOffset; // Aligned to the device's minimum storage buffer offset alignment.
+  // Written to each frame's draws before culling, with no instances yet.
+  std::vector<VkDrawIndexedIndirectCommand> draws;
+  uint32_t objectsCount;
+  DepthPyramid* depthPyramid = nullptr;
+  CullStats stats{};
+
+  VkDescriptorSetLayout descriptorSetLayout;
+  VkDescriptorPool descriptorPool;
+  std::vector<VkDescriptorSet> descriptorSets;
+  VkPipelineLayout pipelineLayout;
+  VkPipeline pipeline;
+
+  // Cache
+  VkDevice cachedDevice;
+  MemoryAllocator &cachedAllocator;
+
+  void createDescriptorSets(SceneDataBuffer* sceneDataBuffer);
+  void createPipeline(VkPipelineCache pipelineCache);
+};
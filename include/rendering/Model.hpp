@@ -7,9 +7,17 @@
 #include <glm/gtx/hash.hpp>
 #include <string>
 
+#include "GeometryPool.hpp"
+
 class Model
 {
 public:
+  // How the vertices are laid out in the vertex buffer.
+  enum class VertexFormat {
+    FULL,  // Vertex, 44 bytes of 32-bit floats.
+    PACKED // PackedVertex, 16 bytes. Only for meshes whose color is the same in every vertex.
+  };
+
   // Structure to specify an array of vertex data.
   struct Vertex {
     glm::vec3 pos;
@@ -18,51 +26,121 @@ public:
     glm::vec3 normalCoords;
 
     // Tell Vulkan how to pass this data format to the vertex shader once it's been uploaded into GPU memory. 
-    static VkVertexInputBindingDescription getBindingDescription();
+    static VkVertexInputBindingDescription getBindingDescription(VertexFormat format = VertexFormat::FULL);
 
     // Describe how to extract a vertex attribute from a chunk of vertex data 
-    // originating from a binding description. We have three attributes: position;
-    // color and texture coordinates. So we need three attribute description structs.
-    static std::array<VkVertexInputAttributeDescription, 4> getAttributeDescriptions();
+    // originating from a binding description. The full format has four attributes:
+    // position, color, texture coordinates and normal. The packed one has no color.
+    static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions(VertexFormat format = VertexFormat::FULL);
+
+    // Hash of the binding and attribute descriptions, so pipelines can be shared
+    // between every model that uses this vertex layout.
+    static size_t getLayoutHash(VertexFormat format = VertexFormat::FULL);
 
     bool operator==(const Vertex& other) const;
   };
 
-  Model(const std::string FILEPATH, const std::vector<Vertex> &vertices, std::vector<uint32_t> indices);
+  // Quantized Vertex. The position is normalized to the mesh's bounding box,
+  // the normal is octahedral encoded and the texture coordinates are halves.
+  struct PackedVertex {
+    uint64_t position;  // R16G16B16A16_UNORM. The last component is padding.
+    uint32_t normal;    // R16G16_SNORM.
+    uint32_t texCoords; // R16G16_SFLOAT.
+  };
+
+  // Constants of the mesh the packed vertices leave out, pushed by bind().
+  struct PackedData {
+    alignas (16) glm::vec4 positionOffset; // Bounding box's min.
+    alignas (16) glm::vec4 positionScale;  // Bounding box's size.
+    alignas (16) glm::vec4 color;
+  };
+
+  // Bounding volumes of the model, in model space.
+  struct Bounds {
+    glm::vec3 min{0.0f};
+    glm::vec3 max{0.0f};
+    glm::vec3 sphereCenter{0.0f};
+    float sphereRadius = 0.0f;
+  };
+
+  // Range of the index buffer drawn for one level of detail. Every level shares the same vertices.
+  struct Lod {
+    uint32_t firstIndex;
+    uint32_t indicesCount;
+    float error; // Distance to the full mesh, relative to the bounding sphere's radius.
+  };
+
+  static constexpr uint32_t MAX_LODS = 4; // Including the full mesh.
+  // Largest error, in pixels, a level of detail may show on screen.
+  static constexpr float LOD_PIXEL_ERROR = 1.0f;
+  // A coarser level is only picked once its error is this much under LOD_PIXEL_ERROR, so objects
+  // around the threshold don't swap levels back and forth every frame.
+  static constexpr float LOD_HYSTERESIS = 0.25f;
+
+  // The indices hold every level of detail one after another, as described by lods.
+  Model(const std::string FILEPATH, const std::vector<Vertex> &vertices, std::vector<uint32_t> indices,
+        const std::vector<Lod> &lods, const Bounds &bounds, VertexFormat vertexFormat = VertexFormat::FULL);
   ~Model();
   void init();
 
   const std::string FILEPATH;
 
-  void bind(VkCommandBuffer commandBuffer);
-  void draw(VkCommandBuffer commandBuffer);
+  // The pipeline layout receives the PackedData of packed models. Only binds the buffers bindings doesn't have yet.
+  void bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, GeometryPool::Bindings &bindings);
+  void draw(VkCommandBuffer commandBuffer, uint32_t instanceCount = 1, uint32_t firstInstance = 0, uint32_t lod = 0);
+  void drawIndirect(VkCommandBuffer commandBuffer, VkBuffer drawsBuffer, VkDeviceSize drawOffset);
 
   // Getters and Setters
 
-  VkBuffer getVertexBuffer();
-  VkDeviceMemory getVertexBufferMemory();
-  VkBuffer getIndexBuffer();
-  VkDeviceMemory getIndexBufferMemory();
-  uint32_t getIndicesCount();
+  VkBuffer getVertexBuffer() const;
+  VkBuffer getIndexBuffer() const;
+  // Where the model's ranges start in the geometry pool's buffers. Added to every draw of the model.
+  int32_t getVertexOffset() const;
+  uint32_t getFirstIndex() const;
+  uint32_t getIndicesCount(); // Of the full mesh.
+  uint32_t getLodsCount() const;
+  const Lod &getLod(uint32_t lod) const;
+  const Bounds &getBounds() const;
+  VertexFormat getVertexFormat() const;
+  VkDeviceSize getVertexBufferSize() const;
+  VkIndexType getIndexType() const;
+  VkDeviceSize getIndexBufferSize() const;
+
+  // 16-bit indices when every vertex can be addressed by them, 32-bit otherwise.
+  static VkIndexType chooseIndexType(size_t verticesCount);
+
+  /**
+   * @brief Picks the coarsest level whose error stays under LOD_PIXEL_ERROR,
+   * starting from the level used last time.
+   *
+   * @param screenRadius Radius of the bounding sphere on screen, in pixels.
+   */
+  uint32_t selectLod(float screenRadius, uint32_t currentLod) const;
 
 private:
   std::vector<Vertex> vertices;  
   std::vector<uint32_t> indices;
 
-  // For vertex buffers
-  VkBuffer vertexBuffer;
-  VkDeviceMemory vertexBufferMemory;
-  // For indices
-  VkBuffer indexBuffer;
-  VkDeviceMemory indexBufferMemory;
+  // Ranges of the geometry pool's buffers
+  GeometryPool::Allocation vertexAllocation;
+  GeometryPool::Allocation indexAllocation;
 
   uint32_t indicesCount;
+  std::vector<Lod> lods;
+  Bounds bounds;
+  VertexFormat vertexFormat;
+  PackedData packedData{};
+  VkDeviceSize vertexBufferSize = 0;
+  VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+  VkDeviceSize indexBufferSize = 0;
 
   // Cache
   VkDevice cachedDevice;
+  GeometryPool* geometryPool = nullptr; // Set by init().
 
-  void createVertexBuffer(const std::vector<Model::Vertex> &vertices);
-  void createIndexBuffer(const std::vector<uint32_t> indices);
+  void createVertexBuffer(const std::vector<Vertex> &vertices);
+  void packVertices(const std::vector<Vertex> &vertices, PackedVertex* packedVertices);
+  void createIndexBuffer(const std::vector<uint32_t> &indices);
 };
 
 namespace std {
@@ -5,6 +5,7 @@
 #include <memory>
 
 #include "DescriptorLayout.hpp"
+#include "PipelineKey.hpp"
 
 class DescriptorLayout;
 class ColorBlending
@@ -17,52 +18,38 @@ public:
   ~ColorBlending();
 };
 
-class Pipeline 
+/**
+ * @brief Graphics pipeline state shared by every object that is drawn with the
+ * same PipelineKey. Pipelines are created and owned by the PipelineCache, so
+ * they shouldn't hold any per-object data.
+ */
+class Pipeline
 {
 private:
   VkPipelineLayout pipelineLayout;
   VkPipeline graphicsPipeline;
   std::unique_ptr<DescriptorLayout> descriptorLayout;
 
-  // For uniform buffers --shaders' global constants.
-  std::vector<VkBuffer> uniformBuffers;
-  std::vector<VkDeviceMemory> uniformBuffersMemory;
-  std::vector<void*> uniformBuffersMapped;
-
   // Cache
   VkDevice cachedDevice;
   VkRenderPass cachedRenderPass;
 
   // Multisample configuration
-  VkPipelineMultisampleStateCreateInfo setupMultisample(VkSampleCountFlagBits msaaSamples);
+  VkPipelineMultisampleStateCreateInfo setupMultisample(VkSampleCountFlagBits msaaSamples, bool sampleShading);
   // Stages:
-  VkPipelineRasterizationStateCreateInfo setupRasterizationStage();
+  VkPipelineRasterizationStateCreateInfo setupRasterizationStage(const PipelineKey &key);
 
 public:
-  struct UniformBufferObject {
-    // Alignas to allign the data with multiples of 64.
-    // For example: glm::mat4 is 64 bits, so we do alignas (16 bytes)
-    //              glm::vec2 is 32 bits, so we do alignas (8 bytes)
-    alignas (16) glm::mat4 model;
-    alignas (16) glm::mat4 view;
-    alignas (16) glm::mat4 proj;
-    alignas (16) glm::mat3 normalMatrix;
-  };
-
   Pipeline(VkDevice device, VkRenderPass renderPass);
   ~Pipeline();
 
-  void createGraphicsPipeline(VkDevice device, VkFormat swapChainImageFormat, 
-                              VkRenderPass renderPass, VkSampleCountFlagBits msaaSamples);
+  void createGraphicsPipeline(VkDevice device, const PipelineKey &key, VkPipelineCache vkPipelineCache,
+                              VkPipelineCreationFeedbackEXT* creationFeedback = nullptr);
   void bind(VkCommandBuffer commandBuffer);
 
-  void updateUniformBuffer(uint32_t currentFrame, int modelRendererIndex);
-  void createUniformBuffers();
-
   // Getters and Setters
 
   VkPipeline getGraphicsPipeline();
   VkPipelineLayout getPipelineLayout();
   const std::unique_ptr<DescriptorLayout> &getDescriptorLayout() const;
-  const std::vector<VkBuffer> getUniformBuffers();
-};
\ No newline at end of file
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <unordered_map>
+#include <vector>
+#include <memory>
+#include <string>
+
+#include "Pipeline.hpp"
+#include "PipelineKey.hpp"
+
+/**
+ * @brief Creates graphics pipelines on demand and hands out the same Pipeline
+ * to every caller that asks with an equal PipelineKey, so a scene with
+ * thousands of identical entities only builds one VkPipeline.
+ *
+ * It also owns the renderer's VkPipelineCache, which is loaded from disk at
+ * startup and written back on destruction, so the driver doesn't have to
+ * compile the same shaders again on every launch.
+ */
+class PipelineCache
+{
+private:
+  // Bump this whenever the layout of the file header changes.
+  static const uint32_t FILE_MAGIC   = 0x50434F50; // "POCP"
+  static const uint32_t FILE_VERSION = 1;
+
+  struct FileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint32_t driverVersion;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+    uint64_t dataSize;
+  };
+
+  std::unordered_map<PipelineKey, std::shared_ptr<Pipeline>> pipelinesMap;
+  VkPipelineCache vkPipelineCache = VK_NULL_HANDLE;
+  const std::string filepath;
+  bool loadedFromDisk = false;
+
+  // Statistics.
+  uint32_t hits   = 0; // Pipelines that were already built in this session.
+  uint32_t misses = 0; // Pipelines that had to be created.
+  uint32_t driverCacheHits   = 0; // Only known when VK_EXT_pipeline_creation_feedback is available.
+  uint32_t driverCacheMisses = 0;
+  double hitsCreationTime    = 0.0; // In milliseconds.
+  double missesCreationTime  = 0.0;
+  double unknownCreationTime = 0.0;
+  bool creationFeedback;
+
+  // Cache
+  VkDevice cachedDevice;
+  VkPhysicalDeviceProperties cachedProperties;
+
+  std::vector<char> loadFile();
+  bool isFileHeaderValid(const FileHeader &header);
+
+public:
+  PipelineCache(VkDevice device, VkPhysicalDevice physicalDevice, const std::string filepath, bool creationFeedback);
+  ~PipelineCache();
+
+  std::shared_ptr<Pipeline> getPipeline(const PipelineKey &key);
+
+  // Destroys every pipeline. Must be called when the render pass is recreated.
+  // The VkPipelineCache is kept, so recreating them is cheap.
+  void clear();
+  void save();
+  void printStats();
+
+  // Getters and Setters
+
+  size_t getPipelinesCount();
+  VkPipelineCache getVkPipelineCache();
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <string>
+#include <functional>
+
+#include "Model.hpp"
+
+/**
+ * @brief Describes every piece of state that makes two graphics pipelines
+ * different. Entities whose keys compare equal can share the same VkPipeline
+ * and VkPipelineLayout.
+ */
+struct PipelineKey
+{
+  std::string shaderID;                // AssetPool's resource ID of the shader.
+  Model::VertexFormat vertexFormat = Model::VertexFormat::FULL;
+  size_t vertexLayoutHash = 0;         // Hash of the vertex binding and attribute descriptions.
+  VkRenderPass renderPass = VK_NULL_HANDLE;
+  VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+  bool sampleShading = false;
+
+  // Rasterization state.
+  VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+  VkCullModeFlags cullMode  = VK_CULL_MODE_BACK_BIT;
+  VkFrontFace frontFace     = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+  bool operator==(const PipelineKey &other) const
+  {
+    return shaderID == other.shaderID && vertexFormat == other.vertexFormat && vertexLayoutHash == other.vertexLayoutHash &&
+           renderPass == other.renderPass && msaaSamples == other.msaaSamples &&
+           sampleShading == other.sampleShading && polygonMode == other.polygonMode &&
+           cullMode == other.cullMode && frontFace == other.frontFace;
+  }
+};
+
+namespace std {
+  template<> struct hash<PipelineKey> {
+    size_t operator()(PipelineKey const& key) const {
+      // Combine hashes the same way boost::hash_combine does.
+      size_t seed = hash<std::string>()(key.shaderID);
+      auto combine = [&seed](size_t value) {
+        seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+      };
+
+      combine(hash<uint32_t>()(static_cast<uint32_t>(key.vertexFormat)));
+      combine(key.vertexLayoutHash);
+      combine(hash<uint64_t>()(reinterpret_cast<uint64_t>(key.renderPass)));
+      combine(hash<uint32_t>()(static_cast<uint32_t>(key.msaaSamples)));
+      combine(hash<bool>()(key.sampleShading));
+      combine(hash<uint32_t>()(static_cast<uint32_t>(key.polygonMode)));
+      combine(hash<uint32_t>()(static_cast<uint32_t>(key.cullMode)));
+      combine(hash<uint32_t>()(static_cast<uint32_t>(key.frontFace)));
+
+      return seed;
+    }
+  };
+}
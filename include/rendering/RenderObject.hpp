@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <memory>
+
+#include "Pipeline.hpp"
+#include "Texture.hpp"
+#include "SceneDataBuffer.hpp"
+
+/**
+ * @brief Rendering data of the objects drawn with the same pipeline and
+ * texture: the descriptor sets that bind the shared SceneDataBuffer and the
+ * texture. Each object picks its own data from the SceneDataBuffer through
+ * its instance index. The graphics pipeline itself is shared between every
+ * RenderObject that was created with the same PipelineKey.
+ */
+class RenderObject
+{
+private:
+  std::shared_ptr<Pipeline> pipeline;
+
+  VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+  std::vector<VkDescriptorSet> descriptorSets;
+
+  // Cache
+  VkDevice cachedDevice;
+
+public:
+  RenderObject(VkDevice device, std::shared_ptr<Pipeline> pipeline);
+  ~RenderObject();
+
+  void createDescriptorPool();
+  void createDescriptorSets(Texture* texture, SceneDataBuffer* sceneDataBuffer);
+
+  void bind(VkCommandBuffer commandBuffer, uint32_t currentFrame);
+
+  // Getters and Setters
+
+  const std::shared_ptr<Pipeline> &getPipeline() const;
+};
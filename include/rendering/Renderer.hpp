@@ -24,6 +24,17 @@
 #include "AssetPool.hpp"
 #include "KeyListener.hpp"
 #include "Pipeline.hpp"
+#include "PipelineCache.hpp"
+#include "RenderObject.hpp"
+#include "SceneDataBuffer.hpp"
+#include "FrameContext.hpp"
+#include "FrustumCuller.hpp"
+#include "GpuCuller.hpp"
+#include "DepthPyramid.hpp"
+#include "GeometryPool.hpp"
+#include "MemoryAllocator.hpp"
+#include "StagingBuffer.hpp"
+#include "UploadBatch.hpp"
 #include "QueueFamilyIndices.hpp"
 #include "SwapChain.hpp"
 #include "Texture.hpp"
@@ -31,6 +42,7 @@
 #include "Model.hpp"
 #include "ECS.hpp"
 #include "ModelRenderer.hpp"
+#include "TransformBatch.hpp"
 
 // Frames which should be processed concurrently.
 const int MAX_FRAMES_IN_FLIGHT = 2;
@@ -75,6 +87,14 @@ public:
 
   bool sampleShading = true;
 
+  // Draws every group of entities that share the same Model and Texture with a single instanced draw call.
+  bool instancedRendering = true;
+  // Culls with a compute shader and draws every batch indirectly. Only used with instancedRendering.
+  bool gpuDrivenRendering = false;
+  // Also culls the objects hidden behind the previous frame's depth. Only used with gpuDrivenRendering.
+  // Changing it needs a restart, since the depth buffer is only kept for it.
+  bool occlusionCulling = true;
+
   Renderer();
   ~Renderer();
 
@@ -83,7 +103,10 @@ public:
 
   void init();
   void initRendering();
+  void updateFrameContext(PerspectiveCamera &camera);
   void drawFrame();
+  // Prints the average CPU time spent preparing and recording a frame since the last call.
+  void printFrameStats();
 
   // Getters and Setters
 
@@ -91,26 +114,77 @@ public:
   VkPhysicalDevice getPhysicalDevice();
   VkCommandPool getCommandPool();
   VkQueue getGraphicsQueue();
+  // Vertices and indices of every model. Freed ranges can be reclaimed with compact().
+  GeometryPool* getGeometryPool();
+  // Every buffer and image is sub-allocated from it.
+  MemoryAllocator &getMemoryAllocator();
+  // Asset uploads are recorded into it, and submitted before the next frame at the latest.
+  UploadBatch &getUploadBatch();
   const std::unique_ptr<SwapChain> &getSwapChain() const;
+  const FrameContext &getFrameContext() const;
 
   VkSampleCountFlagBits getMsaaSample();
   VkSampleCountFlagBits getMaxMsaaSamples();
   const std::optional<std::reference_wrapper<Entity>> getEntity(int index);
-
-  void addEntity(Entity& e);
   
 private:
   VkSurfaceKHR surface;
   std::unique_ptr<VulkanDebugger> vulkanDebugger;
+  std::unique_ptr<MemoryAllocator> memoryAllocator;
   std::unique_ptr<SwapChain> swapChain;
-  std::vector<std::unique_ptr<Pipeline>> pipelines;
-  std::vector<std::reference_wrapper<Entity>> entitiesVec;
+  std::unique_ptr<PipelineCache> pipelineCache;
+  std::unique_ptr<StagingBuffer> stagingBuffer;
+  std::unique_ptr<UploadBatch> uploadBatch;
+  std::unique_ptr<GeometryPool> geometryPool;
+  uint32_t geometryGeneration = 0; // Of the geometry pool when the GPU culler's draws were set.
+  // One per pipeline and texture, shared by the entities that use them.
+  std::vector<std::unique_ptr<RenderObject>> renderObjects;
+  std::vector<uint32_t> entitiesRenderObjects; // Index into renderObjects of each entity in entitiesVec.
+  std::vector<EntityHandle> entitiesVec; // Resolved every frame, so destroyed entities are skipped.
+
+  // Entities that share the same Model and Texture, drawn together when instancedRendering is on.
+  struct InstanceBatch {
+    std::shared_ptr<Model> model;
+    std::unique_ptr<RenderObject> renderObject;
+    uint32_t firstInstance;             // Index of the batch's first object in the SceneDataBuffer.
+    std::array<uint32_t, Model::MAX_LODS> visibleCounts; // Objects that survived this frame's culling, per level of detail.
+    std::vector<size_t> entityIndices;  // Indices into entitiesVec.
+  };
+
+  std::vector<InstanceBatch> instanceBatches;
+  // Camera and per-object data of the whole scene, shared by every render object.
+  std::unique_ptr<SceneDataBuffer> sceneDataBuffer;
+  FrameContext frameContext;
+  // Latest data of every object. Each frame's SceneDataBuffer only copies the objects it's missing.
+  std::vector<SceneDataBuffer::ObjectData> objectsData;
+  std::vector<uint32_t> objectsVersions; // Transform or world version each object was built with. 0 means never built.
+  std::vector<uint8_t> objectsFromHierarchy; // 1 if the object's version is its Hierarchy's world version.
+  std::vector<uint32_t> changedObjects;
+  std::vector<uint32_t> objectsLods; // Level of detail each object was drawn with the last time it was visible.
+  // Transforms that changed this frame. Their matrices are built together, straight into objectsData.
+  TransformBatch transformBatch;
+  FrustumCuller frustumCuller;
+  std::unique_ptr<GpuCuller> gpuCuller; // Only when gpuDrivenRendering is on.
+  std::unique_ptr<DepthPyramid> depthPyramid; // Same.
+
+  // Frame statistics.
+  double recordingTime = 0.0; // In milliseconds.
+  uint32_t recordedFrames = 0;
+  uint64_t trianglesDrawn = 0; // By the last frame culled on the CPU.
+  uint64_t trianglesSaved = 0; // Same, by drawing coarser levels of detail than the full meshes.
 
   VkDevice device;
   VkInstance vkInstance;
 
   VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
 
+  // Pipeline cache data is persisted here between runs.
+  static inline const std::string PIPELINE_CACHE_FILEPATH = "pipeline_cache.bin";
+  // Tells if VK_EXT_pipeline_creation_feedback is enabled, so pipeline cache hits can be reported.
+  bool pipelineCreationFeedback = false;
+  // Tells if indirect draws may start past the first instance, which gpuDrivenRendering needs.
+  bool drawIndirectFirstInstance = false;
+
   VkQueue graphicsQueue;
   VkQueue presentQueue;
 
@@ -138,10 +212,22 @@ private:
   void recreateSwapChain();
   void createCommandPool(VkCommandPool* commandPool, VkCommandPoolCreateFlags commandPoolCreateFlags);
   void createCommandBuffers();
+  void collectEntities();
+  void checkGpuDrivenSupport();
+  bool needsDepthPyramid();
+  void createRenderObjects();
+  void createInstanceBatches();
+  void setGpuDraws();
+  void updateSceneData(uint32_t currentFrame);
+  void cullObjects(uint32_t currentFrame);
+  uint32_t selectLod(uint32_t objectIndex, const Model &model);
+  void createDepthPyramid();
+  PipelineKey createPipelineKey(const std::string &shaderID, Model::VertexFormat vertexFormat);
   void createCommandBuffer(VkCommandBuffer* commandBuffer, uint32_t commandBufferCount, VkCommandPool &commandPool);
   void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
   bool isDeviceSuitable(VkPhysicalDevice device);
   bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+  bool isDeviceExtensionSupported(VkPhysicalDevice device, const char* extensionName);
   std::vector<const char *> getRequiredExtensions();
   bool checkValidationLayerSupport();
 };
\ No newline at end of file
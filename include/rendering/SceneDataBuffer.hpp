@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "MemoryAllocator.hpp"
+
+/**
+ * @brief One persistently mapped buffer per frame in flight, shared by every
+ * object of the scene. It starts with the camera data, read as a uniform
+ * buffer, followed by an array with the data of every object, read as a
+ * storage buffer, and by the indices of the objects that survived culling.
+ * The vertex shader reads objects[instances[gl_InstanceIndex]], so only the
+ * visible objects have to be drawn.
+ */
+class SceneDataBuffer
+{
+public:
+  struct CameraData {
+    alignas (16) glm::mat4 view;
+    alignas (16) glm::mat4 proj;
+    alignas (16) glm::mat4 viewProj;
+  };
+
+  // Laid out following std430. A mat3 would be padded to 3 vec4s anyway, so
+  // the normal matrix is sent as a mat4.
+  struct ObjectData {
+    alignas (16) glm::mat4 model;
+    alignas (16) glm::mat4 normalMatrix;
+  };
+
+  SceneDataBuffer(VkDevice device, VkPhysicalDevice physicalDevice, MemoryAllocator &allocator, uint32_t capacity, uint32_t instancesCapacity);
+  ~SceneDataBuffer();
+
+  // Getters and Setters
+
+  CameraData* getCameraData(uint32_t currentFrame);
+  ObjectData* getObjectsData(uint32_t currentFrame);
+  // Transform version last written to each object of the frame's buffer. 0 means never written.
+  std::vector<uint32_t> &getObjectsVersions(uint32_t currentFrame);
+  // Index into the objects array of each instance drawn.
+  uint32_t* getInstancesData(uint32_t currentFrame);
+  VkBuffer getBuffer(uint32_t currentFrame);
+  VkDeviceSize getObjectsOffset();
+  VkDeviceSize getObjectsRange();
+  VkDeviceSize getInstancesOffset();
+  VkDeviceSize getInstancesRange();
+  uint32_t getCapacity();
+
+private:
+  std::vector<VkBuffer> buffers;
+  std::vector<MemoryAllocator::Allocation> buffersAllocations;
+  std::vector<void*> buffersMapped;
+  std::vector<std::vector<uint32_t>> objectsVersions;
+  VkDeviceSize objectsOffset;   // Aligned to the device's minimum storage buffer offset alignment.
+  VkDeviceSize instancesOffset; // Same.
+  uint32_t capacity;
+  uint32_t instancesCapacity;
+
+  // Cache
+  VkDevice cachedDevice;
+  MemoryAllocator &cachedAllocator;
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <deque>
+#include <cstdint>
+
+#include "MemoryAllocator.hpp"
+
+/**
+ * @brief One persistently mapped host visible buffer that every upload is
+ * staged in, used as a ring. The CPU writes a region straight through its
+ * mapping, the copy out of it is submitted with the fence the ring hands out,
+ * and the region is reused once that fence signals. When the ring is full,
+ * allocating waits for the oldest uploads.
+ *
+ * Regions bigger than the ring, or that don't fit while the rest of the ring
+ * is still waiting to be submitted, get a buffer of their own, which is
+ * destroyed the same way.
+ */
+class StagingBuffer
+{
+public:
+  struct Region {
+    VkBuffer buffer;
+    VkDeviceSize offset; // In buffer.
+    VkDeviceSize size;
+    void* mapped;        // Already offset.
+  };
+
+  static constexpr VkDeviceSize CAPACITY = 32 * 1024 * 1024;
+  // Enough for vertices, indices and texels, whose copies need offsets aligned to their size.
+  static constexpr VkDeviceSize ALIGNMENT = 16;
+
+  StagingBuffer(VkDevice device, MemoryAllocator &allocator, VkDeviceSize capacity = CAPACITY);
+  ~StagingBuffer();
+
+  // The alignment must be a power of two.
+  Region allocate(VkDeviceSize size, VkDeviceSize alignment = ALIGNMENT);
+
+  /**
+   * @brief Fence the copies out of the regions allocated since the last call
+   * must be submitted with. Those regions are reused once it signals, so it
+   * must always be submitted.
+   */
+  VkFence getFence();
+  // Reuses the regions whose copies are done, without waiting.
+  void reclaim();
+  // Waits for every copy submitted so far.
+  void waitIdle();
+
+  // Fences handed out so far. The nth fence handed out is submission n.
+  uint64_t getSubmittedCount() const;
+  // Doesn't wait.
+  bool isRetired(uint64_t submission);
+  void waitFor(uint64_t submission);
+  // Bytes of the ring allocated since the last fence was handed out.
+  VkDeviceSize getPendingSize() const;
+  VkDeviceSize getCapacity() const;
+
+  void printStats();
+
+private:
+  struct Overflow {
+    VkBuffer buffer;
+    MemoryAllocator::Allocation allocation;
+  };
+
+  // Regions handed out between two calls to getFence().
+  struct Submission {
+    VkFence fence;
+    uint64_t end; // Head of the ring when the fence was handed out.
+    std::vector<Overflow> overflows;
+  };
+
+  VkBuffer buffer;
+  MemoryAllocator::Allocation bufferAllocation;
+  VkDeviceSize capacity;
+  // Bytes ever allocated from and given back to the ring, so head - tail is the size in use.
+  uint64_t head = 0;
+  uint64_t tail = 0;
+  uint64_t submittedCount = 0;
+  uint64_t retiredCount = 0;
+  std::vector<Overflow> pendingOverflows; // Not handed a fence yet.
+  std::deque<Submission> submissions;     // Oldest first.
+  std::vector<VkFence> freeFences;
+
+  // Stats
+  uint32_t regionsCount = 0;
+  uint64_t stagedSize = 0;
+  uint32_t waitsCount = 0;
+  uint32_t overflowsCount = 0;
+
+  // Cache
+  VkDevice cachedDevice;
+  MemoryAllocator &cachedAllocator;
+
+  Region allocateOverflow(VkDeviceSize size);
+  void retire(Submission &submission);
+};
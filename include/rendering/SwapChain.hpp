@@ -3,6 +3,8 @@
 #include <vulkan/vulkan.hpp>
 #include <memory>
 
+#include "MemoryAllocator.hpp"
+
 struct SwapChainSupportDetails
 {
   // We need to check for 3 kinds of prorperties:
@@ -28,12 +30,14 @@ private:
 
   // Depth image and view configuration.
   VkImage depthImage;
-  VkDeviceMemory depthImageMemory;
+  MemoryAllocator::Allocation depthImageAllocation;
   VkImageView depthImageView;
+  // Kept after the render pass and sampled by the depth pyramid.
+  bool depthSampled;
 
   // MSAA color drawing.
   VkImage colorImage;
-  VkDeviceMemory colorImageMemory;
+  MemoryAllocator::Allocation colorImageAllocation;
   VkImageView colorImageView;
 
   /**
@@ -59,7 +63,8 @@ private:
   VkFormat findDepthFormat(VkPhysicalDevice physicalDevice);
 
 public:
-  SwapChain(VkPhysicalDevice physicalDevice, VkDevice device, VkSurfaceKHR surface, VkSampleCountFlagBits numMsaaSamples);
+  SwapChain(VkPhysicalDevice physicalDevice, VkDevice device, VkSurfaceKHR surface, VkSampleCountFlagBits numMsaaSamples,
+            bool depthSampled);
   ~SwapChain();
 
   size_t currentFrame = 0;
@@ -106,5 +111,8 @@ public:
   std::vector<VkSemaphore> getRenderFinishedSemaphores();
   std::vector<VkFence> getInFlightFences();
   std::vector<VkFence> getImagesInFlight();
+  // In VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL once the render pass ends, if the depth is sampled.
+  VkImageView getDepthImageView();
+  bool isDepthSampled();
   int getSwapChainImageViewsSize();
 };
\ No newline at end of file
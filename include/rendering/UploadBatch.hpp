@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <cstdint>
+
+#include "StagingBuffer.hpp"
+
+/**
+ * @brief Records the copies and layout transitions of many uploads into a
+ * single command buffer, submitted once with a fence instead of waiting for
+ * the queue after each of them. The data is staged in the staging ring, and
+ * the fence is the ring's, so the regions are reused as soon as the batch is
+ * done.
+ *
+ * Should the regions staged for a batch fill the ring, what was recorded so
+ * far is submitted early and recording goes on in a new command buffer.
+ * Everything submitted is visible to the vertex input, shaders and transfers
+ * of the commands submitted after it.
+ */
+class UploadBatch
+{
+public:
+  UploadBatch(VkDevice device, VkQueue graphicsQueue, VkCommandPool commandPool, StagingBuffer &stagingBuffer);
+  ~UploadBatch();
+
+  // Staging memory for an upload whose copy is recorded right after.
+  StagingBuffer::Region stage(VkDeviceSize size);
+  // Command buffer to record the uploads' commands into. Begins a new one if needed.
+  VkCommandBuffer getCommandBuffer();
+  // Makes the transfers recorded so far visible to the next ones, e.g. before reading or rewriting what they wrote.
+  void transferBarrier();
+
+  // Submits what was recorded, if anything, without waiting.
+  void submit();
+  // True once everything recorded was submitted and is done. Never waits.
+  bool isDone();
+  // Submits what was recorded and waits for it.
+  void wait();
+
+  void printStats();
+
+private:
+  struct Submitted {
+    uint64_t submission; // Of the staging ring.
+    VkCommandBuffer commandBuffer;
+  };
+
+  VkCommandBuffer commandBuffer = VK_NULL_HANDLE; // Being recorded.
+  std::vector<Submitted> submitted;               // Freed once done.
+  uint64_t lastSubmission = 0;
+
+  // Stats
+  uint32_t uploadsCount = 0;
+  uint32_t submitsCount = 0;
+
+  // Cache
+  VkDevice cachedDevice;
+  VkQueue cachedGraphicsQueue;
+  VkCommandPool cachedCommandPool;
+  StagingBuffer &cachedStagingBuffer;
+
+  void freeCommandBuffers();
+};
@@ -2,12 +2,15 @@
 
 #include <vulkan/vulkan.hpp>
 
+#include "MemoryAllocator.hpp"
+#include "UploadBatch.hpp"
+
 class Texture
 {
 private:
   const std::string filepath;
   VkImage textureImage;
-  VkDeviceMemory textureImageMemory;
+  MemoryAllocator::Allocation textureImageAllocation;
   VkImageView textureImageView;
   VkSampler textureSampler;
 
@@ -17,19 +20,18 @@ private:
   // Cache
   VkDevice cachedDevice;
   
-  void copyBufferToImage(VkDevice device, VkQueue graphicsQueue, 
-                                VkCommandPool commandPool,
-                                VkBuffer buffer, VkImage image, 
+  void copyBufferToImage(VkCommandBuffer commandBuffer,
+                                VkBuffer buffer, VkDeviceSize bufferOffset, VkImage image, 
                                 uint32_t width, uint32_t height);
 
-  void generateMipmaps(VkDevice device, VkPhysicalDevice physicalDevice, VkQueue graphicsQueue, VkCommandPool commandPool,
+  void generateMipmaps(VkPhysicalDevice physicalDevice, VkCommandBuffer commandBuffer,
                        VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels);
 
 public:
   Texture(VkDevice device, const std::string filepath);
   ~Texture();
-  void createTextureImage(VkDevice device, VkPhysicalDevice physicalDevice, 
-                                 VkQueue graphicsQueue, VkCommandPool commandPool);
+  // Records the upload into the batch. The image can't be sampled before the batch is submitted.
+  void createTextureImage(VkDevice device, VkPhysicalDevice physicalDevice, UploadBatch &uploadBatch);
   void createTextureImageView(VkDevice device);
   void createTextureSampler(VkDevice device, VkPhysicalDevice physicalDevice);
 
@@ -22,16 +22,31 @@ private:
 	static void insertShader(VkDevice device, const std::string resourceID, const std::string fragmentShaderPath, const std::string vertexShaderPath);
 	static void insertTexture(VkDevice device, const std::string resourceID, const std::string texPath);
 	static void insertModel(const std::string resouceID, const std::string modelPath);
+	static Model::Bounds computeBounds(const std::vector<Model::Vertex> &vertices);
+	static std::vector<Model::Lod> generateLods(const std::string &modelPath, const std::vector<Model::Vertex> &vertices,
+	                                            std::vector<uint32_t> &indices, const Model::Bounds &bounds);
+	static void optimizeMesh(const std::string &modelPath, std::vector<Model::Vertex> &vertices,
+	                         std::vector<uint32_t> &indices, const std::vector<Model::Lod> &lods);
+	static Model::VertexFormat chooseVertexFormat(const std::string &modelPath, const std::vector<Model::Vertex> &vertices);
+
+	// ACMR the overdraw order may lose to the vertex cache order, as a ratio.
+	static constexpr float OVERDRAW_THRESHOLD = 1.05f;
 
 public:
+	// Also sorts the imported meshes for overdraw, for a few more vertex cache misses.
+	// Must be set before the models are added.
+	inline static bool overdrawOptimization = true;
+	// Uploads the imported meshes with Model::PackedVertex when their color doesn't change.
+	// Must be set before the models are added.
+	inline static bool vertexPacking = true;
+
 	static void addShader(VkDevice device, const std::string resourceID, const std::string fragmentShaderPath, const std::string vertexShaderPath);
 	static const std::shared_ptr<Shader> getShader(const std::string resourceID);
 	static void addTexture(VkDevice device, const std::string resourceID, const std::string texPath);
 	static const std::shared_ptr<Texture> getTexture(const std::string resourceID);
 	static void addModel(const std::string resourceID, const std::string modelPath);
 
-	static void loadTextures(VkDevice device, VkPhysicalDevice physicalDevice, 
-													 VkQueue graphicsQueue, VkCommandPool commandPool);
+	static void loadTextures(VkDevice device, VkPhysicalDevice physicalDevice, UploadBatch &uploadBatch);
 	static void loadModels();
 
 	/** TODO: This description is outdated.
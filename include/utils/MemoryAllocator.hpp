@@ -0,0 +1,128 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+/**
+ * @brief Carves buffers and images out of big blocks of device memory, instead
+ * of calling vkAllocateMemory for each one. Drivers only allow a few thousand
+ * allocations (maxMemoryAllocationCount) and each call is slow.
+ *
+ * Each block serves a single memory type and hands out its ranges with a
+ * two-level segregated fit (TLSF) allocator, so allocating and freeing take
+ * constant time and freed ranges merge with their free neighbours. Host
+ * visible blocks stay mapped for as long as they live.
+ *
+ * When bufferImageGranularity isn't 1, linear resources (buffers and linear
+ * images) and optimal images never share a block, so they can't end up on
+ * the same page. Big images get a dedicated allocation.
+ */
+class MemoryAllocator
+{
+private:
+  struct Block;
+
+public:
+  // What is bound to the memory, to keep linear and optimal resources apart.
+  enum class Resource {
+    BUFFER,
+    LINEAR_IMAGE,
+    OPTIMAL_IMAGE
+  };
+
+  struct Allocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    void* mapped = nullptr; // Already offset. Only for host visible memory.
+    uint32_t memoryType = 0;
+    Block* block = nullptr; // nullptr for dedicated allocations.
+    uint32_t node = 0;
+  };
+
+  struct HeapStats {
+    uint32_t blocksCount = 0;
+    VkDeviceSize blocksSize = 0;
+    uint32_t allocationsCount = 0; // Sub-allocated from the blocks.
+    VkDeviceSize usedSize = 0;
+    uint32_t dedicatedCount = 0;
+    VkDeviceSize dedicatedSize = 0;
+  };
+
+  // Size of the blocks, unless the heap is small.
+  static constexpr VkDeviceSize BLOCK_SIZE = 64 * 1024 * 1024;
+  // Images at least this big get their own allocation, so freeing them gives the memory back to the driver.
+  static constexpr VkDeviceSize DEDICATED_IMAGE_SIZE = 16 * 1024 * 1024;
+
+  MemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice);
+  ~MemoryAllocator();
+
+  Allocation allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags properties, Resource resource);
+  // Does nothing for an empty allocation, and empties the allocation.
+  void free(Allocation &allocation);
+
+  std::vector<HeapStats> getHeapStats() const;
+  void printStats() const;
+
+private:
+  static constexpr uint32_t SL_COUNT_LOG2 = 4;    // Second level lists per first level.
+  static constexpr uint32_t SL_COUNT = 1u << SL_COUNT_LOG2;
+  static constexpr uint32_t SMALL_SIZE_LOG2 = 8;  // Sizes under 256 bytes all fall in the first first level list.
+  static constexpr uint32_t FL_COUNT = 32;
+  static constexpr uint32_t NONE = UINT32_MAX;
+
+  // Range of a block. Free nodes are also linked in the list of their size.
+  struct Node {
+    VkDeviceSize offset;
+    VkDeviceSize size;
+    uint32_t previousPhysical = NONE;
+    uint32_t nextPhysical = NONE;
+    uint32_t previousFree = NONE;
+    uint32_t nextFree = NONE;
+    bool free = true;
+  };
+
+  struct Block {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize size = 0;
+    void* mapped = nullptr;
+    uint32_t memoryType = 0;
+    bool linear = true;
+    uint32_t allocationsCount = 0;
+    VkDeviceSize usedSize = 0;
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> unusedNodes;
+    uint32_t flBitmap = 0;
+    uint32_t slBitmaps[FL_COUNT] = {};
+    uint32_t freeLists[FL_COUNT][SL_COUNT];
+
+    explicit Block(VkDeviceSize size);
+    bool allocate(VkDeviceSize size, VkDeviceSize alignment, uint32_t &node);
+    void free(uint32_t node);
+
+  private:
+    static void mapping(VkDeviceSize size, uint32_t &fl, uint32_t &sl);
+    uint32_t createNode(VkDeviceSize offset, VkDeviceSize size);
+    void insertFree(uint32_t node);
+    void removeFree(uint32_t node);
+  };
+
+  std::vector<std::unique_ptr<Block>> blocks;
+  std::vector<uint32_t> dedicatedCounts;      // Per memory type.
+  std::vector<VkDeviceSize> dedicatedSizes;   // Same.
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  VkDeviceSize bufferImageGranularity;
+  uint32_t maxAllocationsCount;
+  uint32_t allocationsCount = 0; // Calls to vkAllocateMemory still alive.
+
+  // Cache
+  VkDevice cachedDevice;
+  VkPhysicalDevice cachedPhysicalDevice;
+
+  VkDeviceSize getBlockSize(uint32_t memoryType) const;
+  VkDeviceMemory allocateMemory(VkDeviceSize size, uint32_t memoryType, void** mapped);
+  void freeMemory(VkDeviceMemory memory, bool mapped);
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "Model.hpp"
+
+/**
+ * @brief Builds the levels of detail of a mesh by collapsing its edges in
+ * order of quadric error (Garland & Heckbert).
+ *
+ * Every collapse moves a vertex onto one of its neighbours instead of making a
+ * new one, so each level only needs new indices and keeps sharing the mesh's
+ * vertices. Vertices on open borders or on attribute seams (same position,
+ * different texture coordinates or colors) never move, which keeps the mesh
+ * closed and its textures in place.
+ */
+class MeshSimplifier
+{
+public:
+  struct Level {
+    std::vector<uint32_t> indices;
+    float error; // Estimated distance between this level and the mesh, in model space. Never below the previous level's.
+  };
+
+  // Collapses stop once a level gets this many indices from the previous one,
+  // since a level that barely saves anything isn't worth drawing.
+  static constexpr float MIN_REDUCTION = 0.85f;
+
+  /**
+   * @brief Halves the triangles of the mesh again for each level, until there
+   * are levelsCount levels or the mesh can't be simplified any further.
+   *
+   * @return The levels after the mesh itself, from the most to the least detailed.
+   */
+  static std::vector<Level> simplify(const std::vector<Model::Vertex> &vertices,
+                                     const std::vector<uint32_t> &indices, uint32_t levelsCount);
+
+private:
+  // Symmetric 4x4 matrix summing the squared distances to a set of planes,
+  // weighted by the area of their triangles.
+  struct Quadric {
+    double a2 = 0.0, b2 = 0.0, c2 = 0.0, d2 = 0.0;
+    double ab = 0.0, ac = 0.0, ad = 0.0, bc = 0.0, bd = 0.0, cd = 0.0;
+    double weight = 0.0;
+
+    void addPlane(const glm::vec3 &normal, float distance, double planeWeight);
+    void add(const Quadric &other);
+    // Average squared distance between the point and the planes.
+    double evaluate(const glm::vec3 &point) const;
+  };
+
+  struct Collapse {
+    uint32_t from; // Vertex that moves.
+    uint32_t to;   // Vertex it moves onto.
+    double cost;
+  };
+
+  static bool flipsTriangles(uint32_t from, uint32_t to, const std::vector<uint32_t> &indices,
+                             const std::vector<uint32_t> &positionIDs, const std::vector<Model::Vertex> &vertices,
+                             const std::vector<uint32_t> &trianglesOffsets, const std::vector<uint32_t> &triangles);
+};
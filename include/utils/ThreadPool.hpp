@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+
+/**
+ * @brief Fixed set of worker threads that run tasks from a shared queue.
+ *
+ * Tasks are submitted into a TaskGroup, and waiting on a group makes the
+ * calling thread run queued tasks before it sleeps, so tasks can themselves
+ * submit and wait for more tasks without deadlocking the pool.
+ */
+class ThreadPool
+{
+public:
+  class TaskGroup
+  {
+  private:
+    std::atomic<size_t> pending{0};
+    std::exception_ptr exception;
+    std::mutex exceptionMutex;
+    // Notified when the last pending task finishes.
+    std::mutex doneMutex;
+    std::condition_variable doneCondition;
+
+    friend class ThreadPool;
+  };
+
+  // By default, one worker per core besides the calling thread, which also runs tasks while it waits.
+  ThreadPool(size_t threadsCount = std::max(std::thread::hardware_concurrency(), 2u) - 1);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool &operator=(const ThreadPool&) = delete;
+
+  void submit(TaskGroup &group, std::function<void()> task);
+  // Blocks until every task of the group has finished. Rethrows the first exception thrown by them.
+  void wait(TaskGroup &group);
+
+  // Splits [0, count) in ranges of, at most, grainSize elements and runs func(begin, end) on each one.
+  void parallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)> &func);
+
+  // Getters and Setters
+
+  size_t getThreadsCount();
+  // 1 to getThreadsCount() inside a worker thread, 0 in any other thread.
+  static size_t getThreadIndex();
+
+private:
+  struct Task {
+    std::function<void()> function;
+    TaskGroup* group;
+  };
+
+  std::vector<std::thread> workers;
+  std::deque<Task> tasks;
+  std::mutex tasksMutex;
+  std::condition_variable tasksCondition;
+  bool stopping = false;
+
+  void workerLoop(size_t threadIndex);
+  bool tryRunTask();
+  void runTask(Task &task);
+};
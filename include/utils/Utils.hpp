@@ -2,34 +2,44 @@
 
 #include <vulkan/vulkan.h>
 
+#include "MemoryAllocator.hpp"
+
 namespace Utils
 {
   uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties, VkPhysicalDevice physicalDevice);
 
   void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, 
                     VkMemoryPropertyFlags properties, VkBuffer& buffer, 
-                    VkDeviceMemory& bufferMemory,
+                    MemoryAllocator::Allocation& bufferAllocation,
                     VkDevice device,
-                    VkPhysicalDevice physicalDevice);
+                    MemoryAllocator& allocator);
+  void destroyBuffer(VkDevice device, VkBuffer buffer, MemoryAllocator::Allocation& bufferAllocation,
+                     MemoryAllocator& allocator);
   
   void copyBuffer(VkDevice device, VkCommandPool commandPool, VkQueue graphicsQueue, 
                           VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
   VkCommandBuffer beginSingleTimeCommands(VkDevice device, VkCommandPool commandPool);
+  // Waits for the queue to be idle. Uploads of assets go through an UploadBatch instead.
   void endSingleTimeCommands(VkDevice device, VkQueue graphicsQueue, 
                                   VkCommandPool commandPool, VkCommandBuffer commandBuffer);
   
   VkImageView createImageView(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels);
 
-  void createImage(VkDevice device, VkPhysicalDevice physicalDevice,
+  void createImage(VkDevice device, MemoryAllocator& allocator,
                    uint32_t texWidth, uint32_t texHeight, uint32_t mipLevels, VkSampleCountFlagBits msaaSamples,
                    VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, 
                    VkMemoryPropertyFlags properties, VkImage& image, 
-                   VkDeviceMemory& imageMemory);
+                   MemoryAllocator::Allocation& imageAllocation);
+  void destroyImage(VkDevice device, VkImage image, MemoryAllocator::Allocation& imageAllocation,
+                    MemoryAllocator& allocator);
 
   void transitionImageLayout(VkDevice device, VkQueue graphicsQueue, 
                              VkCommandPool commandPool, VkImage image, 
                              VkFormat format, VkImageLayout oldLayout, 
                              VkImageLayout newLayout, uint32_t mipLevels);
+  // Same, recorded into a command buffer that is being recorded, e.g. an upload batch's.
+  void recordImageLayoutTransition(VkCommandBuffer commandBuffer, VkImage image, VkFormat format,
+                                   VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels);
 
   bool hasStencilComponent(VkFormat format);
 }
\ No newline at end of file
@@ -0,0 +1,64 @@
+#version 450
+
+// Same as texture_vertex_shader.vert, for models with Model::VertexFormat::PACKED.
+
+layout(set = 0, binding = 0) uniform CameraData {
+  mat4 view;
+  mat4 proj;
+  mat4 viewProj;
+} camera;
+
+struct ObjectData {
+  mat4 model;
+  mat4 normalMatrix;
+};
+
+// Every object of the scene.
+layout(std430, set = 0, binding = 2) readonly buffer ObjectsData {
+  ObjectData objects[];
+} objectsData;
+
+// Objects that survived culling. Each draw call selects its instances through firstInstance.
+layout(std430, set = 0, binding = 3) readonly buffer InstancesData {
+  uint indices[];
+} instancesData;
+
+// Model::PackedData of the mesh being drawn.
+layout(push_constant) uniform PackedData {
+  vec4 positionOffset;
+  vec4 positionScale;
+  vec4 color;
+} mesh;
+
+layout(location = 0) in vec4 inPosition;    // Normalized to the mesh's bounding box.
+layout(location = 2) in vec2 inTexCoords;
+layout(location = 3) in vec2 inNormalCoords; // Octahedral encoded.
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexCoords;
+
+// Same lighting as texture_vertex_shader.vert.
+const vec3 DIRECTION_TO_LIGHT = normalize(vec3(-1.0, -3.0, -1.0));
+const float AMBIENT = 0.2;
+
+vec3 decodeOctahedral(vec2 octahedral) {
+  vec3 normal = vec3(octahedral, 1.0 - abs(octahedral.x) - abs(octahedral.y));
+  // Unfolds the lower half of the octahedron.
+  float fold = max(-normal.z, 0.0);
+  normal.x += normal.x >= 0.0 ? -fold : fold;
+  normal.y += normal.y >= 0.0 ? -fold : fold;
+  return normalize(normal);
+}
+
+void main() {
+  ObjectData object = objectsData.objects[instancesData.indices[gl_InstanceIndex]];
+
+  vec3 position = mesh.positionOffset.xyz + inPosition.xyz * mesh.positionScale.xyz;
+  gl_Position = camera.viewProj * object.model * vec4(position, 1.0);
+
+  vec3 normalWorldSpace = normalize(mat3(object.normalMatrix) * decodeOctahedral(inNormalCoords));
+
+  float lightIntensity = AMBIENT + max(dot(normalWorldSpace, DIRECTION_TO_LIGHT), 0);
+  fragColor = mesh.color.rgb * lightIntensity;
+  fragTexCoords = inTexCoords;
+}
@@ -1,11 +1,25 @@
 #version 450
 
-layout(set = 0, binding = 0) uniform UniformBufferObject {
-  mat4 model;
+layout(set = 0, binding = 0) uniform CameraData {
   mat4 view;
   mat4 proj;
+  mat4 viewProj;
+} camera;
+
+struct ObjectData {
+  mat4 model;
   mat4 normalMatrix;
-} ubo;
+};
+
+// Every object of the scene.
+layout(std430, set = 0, binding = 2) readonly buffer ObjectsData {
+  ObjectData objects[];
+} objectsData;
+
+// Objects that survived culling. Each draw call selects its instances through firstInstance.
+layout(std430, set = 0, binding = 3) readonly buffer InstancesData {
+  uint indices[];
+} instancesData;
 
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
@@ -20,10 +34,12 @@ const vec3 DIRECTION_TO_LIGHT = normalize(vec3(-1.0, -3.0, -1.0));
 const float AMBIENT = 0.2;
 
 void main() {
-  gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
+  ObjectData object = objectsData.objects[instancesData.indices[gl_InstanceIndex]];
+
+  gl_Position = camera.viewProj * object.model * vec4(inPosition, 1.0);
   // gl_Position = vec4(inPosition, 0.0, 1.0);
   
-  vec3 normalWorldSpace = normalize(mat3(ubo.normalMatrix) * inNormalCoords);
+  vec3 normalWorldSpace = normalize(mat3(object.normalMatrix) * inNormalCoords);
 
   float lightIntensity = AMBIENT + max(dot(normalWorldSpace, DIRECTION_TO_LIGHT), 0);
   fragColor = inColor * lightIntensity;
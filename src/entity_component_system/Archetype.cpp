@@ -0,0 +1,209 @@
+#include "Archetype.hpp"
+
+#include <algorithm>
+
+static std::size_t alignUp(std::size_t offset, std::size_t alignment)
+{
+  return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+Archetype::Archetype(const ComponentBitSet &signature, ChunksPool &chunksPool)
+  : signature(signature), chunksPool(chunksPool)
+{
+  std::size_t rowSize = sizeof(Entity*);
+  for (ComponentID id = 0; id < maxComponents; id++) {
+    if (!signature[id]) continue;
+
+    const ComponentTypeInfo &info = getComponentTypeInfos()[id];
+    if (info.alignment > CHUNK_ALIGNMENT) {
+      throw std::runtime_error("Error: Component alignment is bigger than the chunks' alignment.\n");
+    }
+
+    this->componentIDs.push_back(id);
+    rowSize += info.size;
+  }
+
+  // Fit as many rows as possible in a chunk, taking the columns' padding into account.
+  this->chunkCapacity = std::max<std::size_t>(1, CHUNK_SIZE / rowSize);
+  while (this->chunkCapacity > 1 && this->computeLayout(this->chunkCapacity) > CHUNK_SIZE) {
+    this->chunkCapacity--;
+  }
+
+  // Components bigger than a chunk still get one row per chunk.
+  this->chunkBytes = std::max(CHUNK_SIZE, this->computeLayout(this->chunkCapacity));
+}
+
+Archetype::~Archetype()
+{
+  for (Chunk &chunk : this->chunks) {
+    for (ComponentID id : this->componentIDs) {
+      const ComponentTypeInfo &info = getComponentTypeInfos()[id];
+      std::byte* column = chunk.data + this->columnOffsets[id];
+
+      for (std::size_t i = 0; i < chunk.count; i++) {
+        info.destroy(column + i * info.size);
+      }
+    }
+
+    this->freeChunk(chunk.data);
+  }
+}
+
+/**
+ * @brief Places the columns one after the other. The entities' column goes
+ * first, followed by every component column, each aligned to its type.
+ *
+ * @return std::size_t Bytes needed by a chunk with the given capacity.
+ */
+std::size_t Archetype::computeLayout(std::size_t capacity)
+{
+  std::size_t offset = sizeof(Entity*) * capacity;
+
+  for (ComponentID id : this->componentIDs) {
+    const ComponentTypeInfo &info = getComponentTypeInfos()[id];
+    offset = alignUp(offset, info.alignment);
+    this->columnOffsets[id] = offset;
+    offset += info.size * capacity;
+  }
+
+  return offset;
+}
+
+/**
+ * @brief Chunks come from the pool, unless the archetype's rows are too big to
+ * fit in a regular chunk.
+ */
+std::byte* Archetype::allocateChunk()
+{
+  if (this->chunkBytes > CHUNK_SIZE) {
+    return static_cast<std::byte*>(::operator new(this->chunkBytes, std::align_val_t(CHUNK_ALIGNMENT)));
+  }
+
+  return this->chunksPool.create()->data;
+}
+
+void Archetype::freeChunk(std::byte* data)
+{
+  if (this->chunkBytes > CHUNK_SIZE) {
+    ::operator delete(data, std::align_val_t(CHUNK_ALIGNMENT));
+    return;
+  }
+
+  this->chunksPool.destroy(reinterpret_cast<ChunkMemory*>(data));
+}
+
+std::size_t Archetype::addRow(Entity* entity)
+{
+  if (this->chunks.empty() || this->chunks.back().count == this->chunkCapacity) {
+    this->chunks.push_back({ this->allocateChunk(), 0 });
+  }
+
+  Chunk &chunk = this->chunks.back();
+  reinterpret_cast<Entity**>(chunk.data)[chunk.count] = entity;
+  chunk.count++;
+
+  return this->size++;
+}
+
+Entity* Archetype::removeRow(std::size_t row)
+{
+  std::size_t lastRow = this->size - 1;
+  Entity* movedEntity = nullptr;
+
+  for (ComponentID id : this->componentIDs) {
+    const ComponentTypeInfo &info = getComponentTypeInfos()[id];
+    info.destroy(this->getComponent(row, id));
+
+    if (row != lastRow) {
+      info.moveConstruct(this->getComponent(row, id), this->getComponent(lastRow, id));
+      info.destroy(this->getComponent(lastRow, id));
+    }
+  }
+
+  if (row != lastRow) {
+    movedEntity = this->getEntity(lastRow);
+    this->getEntities(row / this->chunkCapacity)[row % this->chunkCapacity] = movedEntity;
+  }
+
+  Chunk &lastChunk = this->chunks.back();
+  lastChunk.count--;
+  this->size--;
+
+  if (lastChunk.count == 0) {
+    this->freeChunk(lastChunk.data);
+    this->chunks.pop_back();
+  }
+
+  return movedEntity;
+}
+
+void Archetype::update(float deltaTime)
+{
+  for (Chunk &chunk : this->chunks) {
+    for (ComponentID id : this->componentIDs) {
+      getComponentTypeInfos()[id].update(chunk.data + this->columnOffsets[id], chunk.count, deltaTime);
+    }
+  }
+}
+
+void Archetype::draw()
+{
+  for (Chunk &chunk : this->chunks) {
+    for (ComponentID id : this->componentIDs) {
+      getComponentTypeInfos()[id].draw(chunk.data + this->columnOffsets[id], chunk.count);
+    }
+  }
+}
+
+// Getters and Setters
+
+const ComponentBitSet &Archetype::getSignature() const
+{
+  return this->signature;
+}
+
+const std::vector<ComponentID> &Archetype::getComponentIDs() const
+{
+  return this->componentIDs;
+}
+
+std::size_t Archetype::getSize() const
+{
+  return this->size;
+}
+
+std::size_t Archetype::getChunksCount() const
+{
+  return this->chunks.size();
+}
+
+std::size_t Archetype::getChunkCapacity() const
+{
+  return this->chunkCapacity;
+}
+
+std::size_t Archetype::getChunkSize(std::size_t chunkIndex) const
+{
+  return this->chunks[chunkIndex].count;
+}
+
+void* Archetype::getColumn(std::size_t chunkIndex, ComponentID id) const
+{
+  return this->chunks[chunkIndex].data + this->columnOffsets[id];
+}
+
+Entity** Archetype::getEntities(std::size_t chunkIndex) const
+{
+  return reinterpret_cast<Entity**>(this->chunks[chunkIndex].data);
+}
+
+void* Archetype::getComponent(std::size_t row, ComponentID id) const
+{
+  const ComponentTypeInfo &info = getComponentTypeInfos()[id];
+  return static_cast<std::byte*>(this->getColumn(row / this->chunkCapacity, id)) + (row % this->chunkCapacity) * info.size;
+}
+
+Entity* Archetype::getEntity(std::size_t row) const
+{
+  return this->getEntities(row / this->chunkCapacity)[row % this->chunkCapacity];
+}
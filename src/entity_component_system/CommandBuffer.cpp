@@ -0,0 +1,84 @@
+#include "CommandBuffer.hpp"
+
+#include <stdexcept>
+
+#include "ThreadPool.hpp"
+
+CommandBuffer::CommandBuffer(std::size_t threadsCount) : threadsCommands(threadsCount)
+{
+
+}
+
+void CommandBuffer::record(Command &&command)
+{
+  std::size_t threadIndex = ThreadPool::getThreadIndex();
+  if (threadIndex >= threadsCommands.size()) {
+    throw std::runtime_error("Error: Recording ECS commands from a thread the command buffer wasn't made for.\n");
+  }
+
+  threadsCommands[threadIndex].push_back(std::move(command));
+}
+
+void CommandBuffer::spawn(std::function<void(Entity&)> init)
+{
+  this->record({ Command::SPAWN, {}, 0, std::move(init) });
+}
+
+void CommandBuffer::destroy(EntityHandle handle)
+{
+  this->record({ Command::DESTROY, handle, 0, {} });
+}
+
+/**
+ * @brief Must only be called while no thread is recording or iterating over
+ * the manager's archetypes.
+ */
+void CommandBuffer::playback(Manager &manager)
+{
+  // Every spawned entity gets its slot in one go, instead of growing the slots one entity at a time.
+  std::size_t spawnsCount = 0;
+  for (const std::vector<Command> &commands : threadsCommands) {
+    for (const Command &command : commands) {
+      if (command.type == Command::SPAWN) spawnsCount++;
+    }
+  }
+  manager.reserveEntities(spawnsCount);
+
+  for (std::vector<Command> &commands : threadsCommands) {
+    for (Command &command : commands) {
+      if (command.type == Command::SPAWN) {
+        Entity &entity = manager.addEntity();
+        if (command.apply) command.apply(entity);
+        continue;
+      }
+
+      Entity* entity = manager.getEntity(command.handle);
+      if (entity == nullptr) continue;
+
+      switch (command.type) {
+        case Command::DESTROY:
+          manager.destroyEntity(command.handle);
+          break;
+        case Command::ADD_COMPONENT:
+          command.apply(*entity);
+          break;
+        case Command::REMOVE_COMPONENT:
+          entity->removeComponent(command.componentID);
+          break;
+        default:
+          break;
+      }
+    }
+
+    commands.clear();
+  }
+}
+
+bool CommandBuffer::isEmpty() const
+{
+  for (const std::vector<Command> &commands : threadsCommands) {
+    if (!commands.empty()) return false;
+  }
+
+  return true;
+}
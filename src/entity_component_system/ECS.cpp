@@ -1,18 +1,104 @@
 #include "ECS.hpp"
 
+Entity::Entity(Manager* manager, EntityHandle handle) : manager(manager), handle(handle)
+{
+
+}
+
+Entity::~Entity()
+{
+  this->detach();
+}
+
+/**
+ * @brief Moves the entity's components into the archetype of the given
+ * signature. Components that aren't part of the new signature are destroyed,
+ * and the new ones are left for the caller to construct.
+ */
+void Entity::migrate(const ComponentBitSet &signature)
+{
+  Archetype* target = this->manager->getArchetype(signature);
+  std::size_t newRow = target->addRow(this);
+
+  if (this->archetype != nullptr) {
+    for (ComponentID id : this->archetype->getComponentIDs()) {
+      if (signature[id]) {
+        getComponentTypeInfos()[id].moveConstruct(target->getComponent(newRow, id), this->archetype->getComponent(this->row, id));
+      }
+    }
+
+    this->detach();
+  }
+
+  this->archetype = target;
+  this->row = newRow;
+  this->manager->structureVersion++;
+  this->componentBitSet = signature;
+  this->refreshComponentArray();
+}
+
+/**
+ * @brief Removes the entity's row from its archetype. The entity that fills the
+ * hole gets its cached component pointers fixed.
+ */
+void Entity::detach()
+{
+  if (this->archetype == nullptr) return;
+
+  Entity* movedEntity = this->archetype->removeRow(this->row);
+  if (movedEntity != nullptr) {
+    movedEntity->row = this->row;
+    movedEntity->refreshComponentArray();
+  }
+
+  this->archetype = nullptr;
+  this->componentArray.fill(nullptr);
+  this->componentBitSet.reset();
+  this->manager->structureVersion++;
+}
+
+// Components must have Component as their first base, so a column's address is also the component's one.
+void Entity::refreshComponentArray()
+{
+  this->componentArray.fill(nullptr);
+  for (ComponentID id : this->archetype->getComponentIDs()) {
+    this->componentArray[id] = static_cast<Component*>(this->archetype->getComponent(this->row, id));
+  }
+}
+
+void Entity::removeComponent(ComponentID id)
+{
+  if (!componentBitSet[id]) return;
+
+  ComponentBitSet signature = componentBitSet;
+  signature[id] = false;
+
+  if (signature.none()) {
+    this->detach();
+    return;
+  }
+
+  this->migrate(signature);
+}
+
 void Entity::update(float deltaTime)
 {
-  for (auto &c : componentsVec) c->update(deltaTime);
+  if (this->archetype == nullptr) return;
+  for (ComponentID id : this->archetype->getComponentIDs()) componentArray[id]->update(deltaTime);
 }
 
 void Entity::draw()
 {
-  for (auto &c : componentsVec) c->draw();
+  if (this->archetype == nullptr) return;
+  for (ComponentID id : this->archetype->getComponentIDs()) componentArray[id]->draw();
 }
 
 void Entity::pop()
 {
+  if (!this->active) return;
+
   this->active = false;
+  this->manager->poppedEntities.push_back(this->handle);
 }
 
 bool Entity::isActive()
@@ -20,29 +106,165 @@ bool Entity::isActive()
   return this->active;
 }
 
+EntityHandle Entity::getHandle() const
+{
+  return this->handle;
+}
+
+Manager::~Manager()
+{
+  // Entities release their rows, so they have to go before the archetypes.
+  for (Entity* entity : entitiesSlots) {
+    if (entity != nullptr) entitiesPool.destroy(entity);
+  }
+  entitiesSlots.clear();
+}
+
+/**
+ * @brief Updates every component, one archetype column at a time.
+ */
 void Manager::update(float deltaTime)
 {
-  for (auto &e : entitiesList) e->update(deltaTime);
+  for (Archetype* archetype : archetypesVec) archetype->update(deltaTime);
 }
 
 void Manager::draw()
 {
-  for (auto &e : entitiesList) e->draw();
+  for (Archetype* archetype : archetypesVec) archetype->draw();
 }
 
 void Manager::refresh()
 {
-  entitiesList.erase(std::remove_if(std::begin(entitiesList), std::end(entitiesList), [](const std::unique_ptr<Entity> &mEntity)
-  {
-    return !mEntity->isActive();
-  }), std::end(entitiesList)
-  );
+  for (EntityHandle handle : poppedEntities) {
+    this->destroyEntity(handle);
+  }
+
+  poppedEntities.clear();
 }
 
 Entity &Manager::addEntity()
 {
-  Entity *e = new Entity();
-  std::unique_ptr<Entity> uPtr{ e };
-  entitiesList.emplace_back(std::move(uPtr));
-  return *e;
-}
\ No newline at end of file
+  uint32_t index;
+  if (!freeSlots.empty()) {
+    index = freeSlots.back();
+    freeSlots.pop_back();
+  }
+  else {
+    index = static_cast<uint32_t>(entitiesSlots.size());
+    entitiesSlots.push_back(nullptr);
+    generations.push_back(1);
+  }
+
+  entitiesSlots[index] = entitiesPool.create(this, EntityHandle{ index, generations[index] });
+  entitiesCount++;
+
+  return *entitiesSlots[index];
+}
+
+void Manager::reserveEntities(std::size_t count)
+{
+  if (count <= freeSlots.size()) return;
+
+  std::size_t newSlots = count - freeSlots.size();
+  entitiesSlots.reserve(entitiesSlots.size() + newSlots);
+  generations.reserve(generations.size() + newSlots);
+}
+
+/**
+ * @brief Destroys the entity right away in O(1): its archetype row is filled
+ * with the last one and its slot goes to the free list. Stale handles are ignored.
+ */
+void Manager::destroyEntity(EntityHandle handle)
+{
+  if (!this->isAlive(handle)) return;
+
+  entitiesPool.destroy(entitiesSlots[handle.index]);
+  entitiesSlots[handle.index] = nullptr;
+  entitiesCount--;
+
+  // Invalidates every handle to the old entity. Generation 0 is skipped on wrap-around.
+  generations[handle.index]++;
+  if (generations[handle.index] == 0) generations[handle.index] = 1;
+
+  freeSlots.push_back(handle.index);
+}
+
+bool Manager::isAlive(EntityHandle handle) const
+{
+  return handle.index < generations.size() && generations[handle.index] == handle.generation &&
+         entitiesSlots[handle.index] != nullptr;
+}
+
+/**
+ * @brief Gets the archetypes whose components include every component of the
+ * query. The list is only built the first time a query is asked.
+ */
+const std::vector<Archetype*> &Manager::getMatchingArchetypes(const ComponentBitSet &query)
+{
+  std::lock_guard<std::mutex> lock(archetypesMutex);
+
+  auto mapObj = queriesCache.find(query);
+  if (mapObj != queriesCache.end()) {
+    return mapObj->second;
+  }
+
+  std::vector<Archetype*> matches;
+  for (Archetype* archetype : archetypesVec) {
+    if ((archetype->getSignature() & query) == query) matches.push_back(archetype);
+  }
+
+  return queriesCache.insert({ query, std::move(matches) }).first->second;
+}
+
+// Getters and Setters
+
+Archetype* Manager::getArchetype(const ComponentBitSet &signature)
+{
+  std::lock_guard<std::mutex> lock(archetypesMutex);
+
+  auto mapObj = archetypesMap.find(signature);
+  if (mapObj != archetypesMap.end()) {
+    return mapObj->second.get();
+  }
+
+  std::unique_ptr<Archetype> archetype = std::make_unique<Archetype>(signature, chunksPool);
+  Archetype* archetypePtr = archetype.get();
+  archetypesMap.insert({ signature, std::move(archetype) });
+  archetypesVec.push_back(archetypePtr);
+
+  // Cached queries that match the new archetype have to see it.
+  for (auto &[query, matches] : queriesCache) {
+    if ((signature & query) == query) matches.push_back(archetypePtr);
+  }
+
+  return archetypePtr;
+}
+
+Entity* Manager::getEntity(EntityHandle handle) const
+{
+  return this->isAlive(handle) ? entitiesSlots[handle.index] : nullptr;
+}
+
+std::size_t Manager::getEntitiesCount() const
+{
+  return this->entitiesCount;
+}
+
+uint64_t Manager::getStructureVersion() const
+{
+  return this->structureVersion;
+}
+
+void Manager::printStats() const
+{
+  std::cout << "INFO: Entities pool: " << entitiesPool.getSize() << "/" << entitiesPool.getCapacity()
+            << " slot(s) in use, " << entitiesPool.getReservedBytes() / 1024 << " KiB reserved.\n";
+  std::cout << "INFO: Chunks pool: " << chunksPool.getSize() << "/" << chunksPool.getCapacity()
+            << " chunk(s) in use by " << archetypesVec.size() << " archetype(s), "
+            << chunksPool.getReservedBytes() / 1024 << " KiB reserved.\n";
+}
+
+const std::vector<Archetype*> &Manager::getArchetypes() const
+{
+  return this->archetypesVec;
+}
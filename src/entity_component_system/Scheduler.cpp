@@ -0,0 +1,74 @@
+#include "Scheduler.hpp"
+
+#include <atomic>
+#include <functional>
+
+Scheduler::Scheduler(ThreadPool &threadPool)
+  : threadPool(threadPool), commandBuffer(threadPool.getThreadsCount() + 1)
+{
+
+}
+
+/**
+ * @brief Links every pair of conflicting systems, from the one that was added
+ * first to the one that was added later, so the frame's result doesn't depend
+ * on which thread ran first.
+ */
+void Scheduler::buildDependencyGraph()
+{
+  dependents.assign(systems.size(), {});
+  dependenciesCount.assign(systems.size(), 0);
+
+  for (size_t i = 0; i < systems.size(); i++) {
+    for (size_t j = i + 1; j < systems.size(); j++) {
+      if (systems[i]->conflictsWith(*systems[j])) {
+        dependents[i].push_back(j);
+        dependenciesCount[j]++;
+      }
+    }
+  }
+}
+
+void Scheduler::update(Manager &manager, float deltaTime)
+{
+  if (!systems.empty()) {
+    this->runSystems(manager, deltaTime);
+  }
+
+  // Sync point: no system is running, so the archetypes can be changed.
+  commandBuffer.playback(manager);
+}
+
+/**
+ * @brief Runs every system once. A system is handed to the thread pool as soon
+ * as all the systems it depends on have finished.
+ */
+void Scheduler::runSystems(Manager &manager, float deltaTime)
+{
+  this->buildDependencyGraph();
+
+  std::unique_ptr<std::atomic<size_t>[]> remaining(new std::atomic<size_t>[systems.size()]);
+  for (size_t i = 0; i < systems.size(); i++) remaining[i] = dependenciesCount[i];
+
+  ThreadPool::TaskGroup group;
+  std::function<void(size_t)> run = [&](size_t i) {
+    systems[i]->update(manager, commandBuffer, threadPool, deltaTime);
+
+    for (size_t j : dependents[i]) {
+      if (--remaining[j] == 0) threadPool.submit(group, [&run, j] { run(j); });
+    }
+  };
+
+  for (size_t i = 0; i < systems.size(); i++) {
+    if (dependenciesCount[i] == 0) threadPool.submit(group, [&run, i] { run(i); });
+  }
+
+  threadPool.wait(group);
+}
+
+// Getters and Setters
+
+CommandBuffer &Scheduler::getCommandBuffer()
+{
+  return this->commandBuffer;
+}
@@ -0,0 +1,38 @@
+#include "Hierarchy.hpp"
+
+Hierarchy::Hierarchy(EntityHandle parent) : parent(parent)
+{
+
+}
+
+Hierarchy::Hierarchy()
+{
+
+}
+
+// Getters and Setters
+
+EntityHandle Hierarchy::getParent() const
+{
+  return this->parent;
+}
+
+void Hierarchy::setParent(EntityHandle parent)
+{
+  this->parent = parent;
+}
+
+const glm::mat4 &Hierarchy::getWorldMatrix() const
+{
+  return this->worldMatrix;
+}
+
+const glm::mat3 &Hierarchy::getWorldNormalMatrix() const
+{
+  return this->worldNormalMatrix;
+}
+
+uint32_t Hierarchy::getWorldVersion() const
+{
+  return this->worldVersion;
+}
@@ -0,0 +1,185 @@
+#include "HierarchySystem.hpp"
+
+#include <unordered_map>
+#include <algorithm>
+#include <iostream>
+
+HierarchySystem::HierarchySystem() : System("HierarchySystem")
+{
+  // Getting a Transform's matrices rebuilds its cache, so the Transforms are written too.
+  writes<Transform, Hierarchy>();
+}
+
+void HierarchySystem::update(Manager &manager, CommandBuffer &/*commands*/, ThreadPool &threadPool, float /*deltaTime*/)
+{
+  if (manager.getStructureVersion() != this->structureVersion) {
+    this->rebuild(manager);
+  }
+
+  this->propagate(threadPool);
+
+  // A node got a new parent, so the depths are stale. Rare enough to just redo everything.
+  if (this->parentsChanged) {
+    this->rebuild(manager);
+    this->propagate(threadPool);
+  }
+}
+
+/**
+ * @brief Gathers every entity with a Transform and a Hierarchy and sorts them
+ * by depth, with a counting sort. Every node is left dirty, so the next
+ * propagation computes all the world matrices.
+ */
+void HierarchySystem::rebuild(Manager &manager)
+{
+  this->structureVersion = manager.getStructureVersion();
+  this->parentsChanged = false;
+
+  std::vector<Node> unsortedNodes;
+  std::unordered_map<EntityHandle, int32_t> nodesIndices;
+  manager.each<Transform, Hierarchy>([&](Entity &entity, Transform &transform, Hierarchy &hierarchy) {
+    nodesIndices.insert({ entity.getHandle(), static_cast<int32_t>(unsortedNodes.size()) });
+    unsortedNodes.push_back({ hierarchy.getParent(), &transform, &hierarchy, -1, -1, 0 });
+  });
+
+  std::size_t nodesCount = unsortedNodes.size();
+  for (Node &node : unsortedNodes) {
+    auto parentObj = nodesIndices.find(node.parent);
+    if (parentObj != nodesIndices.end()) node.parentNode = parentObj->second;
+  }
+
+  // Walks up from each node until a node with a known depth, then sets the
+  // depths of the walked nodes on the way back.
+  const uint32_t UNKNOWN_DEPTH = UINT32_MAX, VISITING = UINT32_MAX - 1;
+  std::vector<uint32_t> depths(nodesCount, UNKNOWN_DEPTH);
+  std::vector<int32_t> path;
+  uint32_t maxDepth = 0;
+
+  for (std::size_t i = 0; i < nodesCount; i++) {
+    int32_t current = static_cast<int32_t>(i);
+    while (current >= 0 && depths[current] == UNKNOWN_DEPTH) {
+      depths[current] = VISITING;
+      path.push_back(current);
+      current = unsortedNodes[current].parentNode;
+    }
+
+    if (current >= 0 && depths[current] == VISITING) {
+      std::cout << "Warning: Cycle in the transforms hierarchy. One of its parent links is ignored.\n";
+      unsortedNodes[current].parentNode = -1;
+      depths[current] = 0;
+    }
+
+    uint32_t depth = current >= 0 ? depths[current] + 1 : 0;
+    for (auto node = path.rbegin(); node != path.rend(); node++) {
+      if (depths[*node] == VISITING) depths[*node] = depth++;
+      else depth = depths[*node] + 1;
+    }
+    path.clear();
+
+    maxDepth = std::max(maxDepth, depths[i]);
+  }
+
+  this->levelsOffsets.assign(nodesCount > 0 ? maxDepth + 2 : 1, 0);
+  for (std::size_t i = 0; i < nodesCount; i++) this->levelsOffsets[depths[i] + 1]++;
+  for (std::size_t level = 1; level < this->levelsOffsets.size(); level++) {
+    this->levelsOffsets[level] += this->levelsOffsets[level - 1];
+  }
+
+  std::vector<std::size_t> sortedIndices(nodesCount);
+  std::vector<std::size_t> levelsEnds(this->levelsOffsets.begin(), this->levelsOffsets.end() - 1);
+  for (std::size_t i = 0; i < nodesCount; i++) sortedIndices[i] = levelsEnds[depths[i]]++;
+
+  this->nodes.resize(nodesCount);
+  this->roots.clear();
+  std::unordered_map<EntityHandle, int32_t> rootsIndices;
+
+  for (std::size_t i = 0; i < nodesCount; i++) {
+    Node node = unsortedNodes[i];
+    if (node.parentNode >= 0) {
+      node.parentNode = static_cast<int32_t>(sortedIndices[node.parentNode]);
+    }
+    else {
+      Entity* parent = manager.getEntity(node.parent);
+      if (parent != nullptr && parent->hasComponent<Transform>()) {
+        auto rootObj = rootsIndices.find(node.parent);
+        if (rootObj == rootsIndices.end()) {
+          rootObj = rootsIndices.insert({ node.parent, static_cast<int32_t>(this->roots.size()) }).first;
+          this->roots.push_back({ &parent->getComponent<Transform>(), glm::mat4{1.0f}, 0 });
+        }
+        node.rootIndex = rootObj->second;
+      }
+    }
+
+    this->nodes[sortedIndices[i]] = node;
+  }
+
+  this->nodesChanged.assign(nodesCount, 0);
+  this->rootsChanged.assign(this->roots.size(), 0);
+}
+
+/**
+ * @brief Updates the roots and then the nodes, one depth level at a time.
+ * Nodes of the same level only read from the previous one, so each level is
+ * split between the threads.
+ */
+void HierarchySystem::propagate(ThreadPool &threadPool)
+{
+  threadPool.parallelFor(this->roots.size(), GRAIN_SIZE, [this](std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; i++) {
+      Root &root = this->roots[i];
+      uint32_t version = root.transform->getVersion();
+
+      this->rootsChanged[i] = version != root.version;
+      if (this->rootsChanged[i]) {
+        root.modelMatrix = root.transform->getModelMatrix();
+        root.version = version;
+      }
+    }
+  });
+
+  for (std::size_t level = 0; level + 1 < this->levelsOffsets.size(); level++) {
+    std::size_t levelBegin = this->levelsOffsets[level];
+    std::size_t levelSize  = this->levelsOffsets[level + 1] - levelBegin;
+
+    threadPool.parallelFor(levelSize, GRAIN_SIZE, [this, levelBegin](std::size_t begin, std::size_t end) {
+      for (std::size_t i = levelBegin + begin; i < levelBegin + end; i++) this->updateNode(i);
+    });
+  }
+}
+
+void HierarchySystem::updateNode(std::size_t index)
+{
+  Node &node = this->nodes[index];
+  Hierarchy &hierarchy = *node.hierarchy;
+
+  if (hierarchy.getParent() != node.parent) {
+    this->parentsChanged = true;
+  }
+
+  bool parentChanged = false;
+  if (node.parentNode >= 0)     parentChanged = this->nodesChanged[node.parentNode];
+  else if (node.rootIndex >= 0) parentChanged = this->rootsChanged[node.rootIndex];
+
+  uint32_t version = node.transform->getVersion();
+  if (!parentChanged && version == node.localVersion) {
+    this->nodesChanged[index] = 0;
+    return;
+  }
+
+  const glm::mat4 &localMatrix = node.transform->getModelMatrix();
+  if (node.parentNode >= 0) {
+    hierarchy.worldMatrix = this->nodes[node.parentNode].hierarchy->worldMatrix * localMatrix;
+  }
+  else if (node.rootIndex >= 0) {
+    hierarchy.worldMatrix = this->roots[node.rootIndex].modelMatrix * localMatrix;
+  }
+  else {
+    hierarchy.worldMatrix = localMatrix;
+  }
+
+  hierarchy.worldNormalMatrix = glm::transpose(glm::inverse(glm::mat3(hierarchy.worldMatrix)));
+  hierarchy.worldVersion++;
+
+  node.localVersion = version;
+  this->nodesChanged[index] = 1;
+}
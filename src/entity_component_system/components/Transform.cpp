@@ -17,6 +17,13 @@ Transform::Transform()
 void Transform::build(glm::vec3 position)
 {
   this->position = position;
+  this->markDirty();
+}
+
+void Transform::markDirty()
+{
+  this->dirty = true;
+  this->version++;
 }
 
 void Transform::update(float deltaTime)
@@ -27,6 +34,7 @@ void Transform::update(float deltaTime)
 void Transform::translate(glm::vec3 translation)
 {
   this->position += translation;
+  this->markDirty();
 }
 
 void Transform::translate(float x, float y, float z)
@@ -34,6 +42,7 @@ void Transform::translate(float x, float y, float z)
   this->position.x += x;
   this->position.y += y;
   this->position.z += z;
+  this->markDirty();
 }
 
 void Transform::rotate(float xDegreeAngle, float yDegreeAngle, float zDegreeAngle) 
@@ -67,11 +76,14 @@ void Transform::rotate(float xDegreeAngle, float yDegreeAngle, float zDegreeAngl
   else {
     this->rotation.z += xDegreeAngle;
   }
+
+  this->markDirty();
 }
 
 void Transform::scale(glm::vec3 scale)
 {
   this->scaleVec += scale;
+  this->markDirty();
 }
 
 void Transform::scale(float x, float y, float z)
@@ -79,17 +91,35 @@ void Transform::scale(float x, float y, float z)
   this->scaleVec.x += x;
   this->scaleVec.y += y;
   this->scaleVec.z += z;
+  this->markDirty();
+}
+
+/**
+ * @brief Recomputes the model and normal matrices. Only called when a
+ * getter finds the transform dirty, so static objects pay for it once.
+ */
+void Transform::rebuildMatrices()
+{
+  this->modelMatrix  = getTranslationMatrix() * getScaleMatrix() * getRotationMatrix();
+  this->normalMatrix = glm::transpose(glm::inverse(glm::mat3(this->modelMatrix)));
+  this->dirty = false;
+}
+
+const glm::mat4 &Transform::getModelMatrix()
+{
+  if (this->dirty) this->rebuildMatrices();
+  return this->modelMatrix;
 }
 
-glm::mat4 Transform::getModelMatrix()
+const glm::mat3 &Transform::getNormalMatrix()
 {
-  return getTranslationMatrix() * getScaleMatrix() * getRotationMatrix();
+  if (this->dirty) this->rebuildMatrices();
+  return this->normalMatrix;
 }
 
-glm::mat3 Transform::getNormalMatrix()
+uint32_t Transform::getVersion() const
 {
-  glm::mat4 modelMatrix = getModelMatrix();
-  return glm::transpose(glm::inverse(glm::mat3(modelMatrix)));
+  return this->version;
 }
 
 glm::mat4 Transform::getTranslationMatrix()
@@ -123,6 +153,7 @@ void Transform::setPosition(float x, float y, float z)
   this->position.x = x;
   this->position.y = y;
   this->position.z = z;
+  this->markDirty();
 }
 
 const glm::vec3 Transform::getScale()
@@ -135,6 +166,7 @@ void Transform::setScale(float x, float y, float z)
   this->scaleVec.x = x;
   this->scaleVec.y = y;
   this->scaleVec.z = z;
+  this->markDirty();
 }
 
 const glm::vec3 Transform::getRotation()
@@ -147,4 +179,5 @@ void Transform::setRotation(float xAngleDegrees, float yAngleDegrees, float zAng
   this->rotation.x = xAngleDegrees;
   this->rotation.y = yAngleDegrees;
   this->rotation.z = zAngleDegrees;
+  this->markDirty();
 }
\ No newline at end of file
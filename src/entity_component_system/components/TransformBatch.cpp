@@ -0,0 +1,143 @@
+#include "TransformBatch.hpp"
+#include "TransformBatchKernel.hpp"
+
+#include <cmath>
+
+#if defined(TRANSFORM_BATCH_X86) && defined(_MSC_VER)
+  #include <intrin.h>
+#endif
+
+namespace {
+  // Fallback, and the tail of the SIMD kernels. Masks are 1.0f or 0.0f.
+  struct ScalarOps {
+    static constexpr std::size_t WIDTH = 1;
+    using Float = float;
+    using Int   = int32_t;
+
+    static Float set(float value) { return value; }
+    static Float load(const float* src) { return *src; }
+    static void store(float* dst, Float value) { *dst = value; }
+    static Float add(Float a, Float b) { return a + b; }
+    static Float sub(Float a, Float b) { return a - b; }
+    static Float mul(Float a, Float b) { return a * b; }
+    static Float div(Float a, Float b) { return a / b; }
+    static Int toInt(Float value) { return static_cast<Int>(std::lrint(value)); }
+    static Float toFloat(Int value) { return static_cast<Float>(value); }
+    static Int addInt(Int a, int32_t b) { return a + b; }
+    static Float bitTest(Int value, int32_t bit) { return (value & bit) ? 1.0f : 0.0f; }
+    static Float select(Float mask, Float a, Float b) { return mask != 0.0f ? a : b; }
+    static Float negateIf(Float value, Float mask) { return mask != 0.0f ? -value : value; }
+  };
+
+  TransformBatch::InstructionSet detectInstructionSet()
+  {
+#if defined(TRANSFORM_BATCH_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] >= 7) {
+      __cpuid(info, 1);
+      bool osxsave = (info[2] & (1 << 27)) != 0;
+      bool avx     = (info[2] & (1 << 28)) != 0;
+
+      __cpuidex(info, 7, 0);
+      bool avx2 = (info[1] & (1 << 5)) != 0;
+
+      // The OS must also save the YMM registers on context switches.
+      if (osxsave && avx && avx2 && (_xgetbv(0) & 0x6) == 0x6) return TransformBatch::InstructionSet::AVX2;
+    }
+    return TransformBatch::InstructionSet::SSE;
+#elif defined(TRANSFORM_BATCH_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return TransformBatch::InstructionSet::AVX2;
+    return TransformBatch::InstructionSet::SSE;
+#else
+    return TransformBatch::InstructionSet::SCALAR;
+#endif
+  }
+}
+
+void TransformBatch::clear()
+{
+  for (int axis = 0; axis < 3; axis++) {
+    positions[axis].clear();
+    rotations[axis].clear();
+    scales[axis].clear();
+  }
+  targets.clear();
+}
+
+void TransformBatch::reserve(std::size_t count)
+{
+  for (int axis = 0; axis < 3; axis++) {
+    positions[axis].reserve(count);
+    rotations[axis].reserve(count);
+    scales[axis].reserve(count);
+  }
+  targets.reserve(count);
+}
+
+void TransformBatch::add(uint32_t target, const glm::vec3 &position, const glm::vec3 &rotation, const glm::vec3 &scale)
+{
+  for (int axis = 0; axis < 3; axis++) {
+    positions[axis].push_back(position[axis]);
+    rotations[axis].push_back(rotation[axis]);
+    scales[axis].push_back(scale[axis]);
+  }
+  targets.push_back(target);
+}
+
+void TransformBatch::computeMatrices(float* models, float* normals, std::size_t stride) const
+{
+  TransformBatchData data{};
+  for (int axis = 0; axis < 3; axis++) {
+    data.position[axis] = positions[axis].data();
+    data.rotation[axis] = rotations[axis].data();
+    data.scale[axis]    = scales[axis].data();
+  }
+  data.targets = targets.data();
+  data.count   = targets.size();
+  data.models  = models;
+  data.normals = normals;
+  data.stride  = stride;
+
+  std::size_t done = 0;
+#ifdef TRANSFORM_BATCH_X86
+  switch (getInstructionSet()) {
+    case InstructionSet::AVX2:
+      done = computeMatricesAVX2(data);
+      break;
+    case InstructionSet::SSE:
+      done = computeMatricesSSE(data);
+      break;
+    default:
+      break;
+  }
+#endif
+
+  // Whatever doesn't fill a whole vector.
+  for (std::size_t i = done; i < data.count; i++) {
+    TransformBatchKernel::computeMatrices<ScalarOps>(data, i);
+  }
+}
+
+// Getters and Setters
+
+std::size_t TransformBatch::getSize() const
+{
+  return this->targets.size();
+}
+
+TransformBatch::InstructionSet TransformBatch::getInstructionSet()
+{
+  static const InstructionSet instructionSet = detectInstructionSet();
+  return instructionSet;
+}
+
+const char* TransformBatch::getInstructionSetName()
+{
+  switch (getInstructionSet()) {
+    case InstructionSet::AVX2: return "AVX2";
+    case InstructionSet::SSE:  return "SSE";
+    default:                   return "scalar";
+  }
+}
@@ -0,0 +1,39 @@
+#include "TransformBatchKernel.hpp"
+
+#ifdef TRANSFORM_BATCH_X86
+
+// Built with AVX2 enabled (see CMakeLists.txt). Only called once the CPU has been checked.
+#include <immintrin.h>
+
+namespace {
+  struct AVX2Ops {
+    static constexpr std::size_t WIDTH = 8;
+    using Float = __m256;
+    using Int   = __m256i;
+
+    static Float set(float value) { return _mm256_set1_ps(value); }
+    static Float load(const float* src) { return _mm256_loadu_ps(src); }
+    static void store(float* dst, Float value) { _mm256_store_ps(dst, value); }
+    static Float add(Float a, Float b) { return _mm256_add_ps(a, b); }
+    static Float sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+    static Float mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+    static Float div(Float a, Float b) { return _mm256_div_ps(a, b); }
+    static Int toInt(Float value) { return _mm256_cvtps_epi32(value); } // Rounds to nearest.
+    static Float toFloat(Int value) { return _mm256_cvtepi32_ps(value); }
+    static Int addInt(Int a, int32_t b) { return _mm256_add_epi32(a, _mm256_set1_epi32(b)); }
+    static Float bitTest(Int value, int32_t bit)
+    {
+      __m256i bits = _mm256_set1_epi32(bit);
+      return _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(value, bits), bits));
+    }
+    static Float select(Float mask, Float a, Float b) { return _mm256_blendv_ps(b, a, mask); }
+    static Float negateIf(Float value, Float mask) { return _mm256_xor_ps(value, _mm256_and_ps(mask, _mm256_set1_ps(-0.0f))); }
+  };
+}
+
+std::size_t computeMatricesAVX2(const TransformBatchData &data)
+{
+  return TransformBatchKernel::computeMatrices<AVX2Ops>(data);
+}
+
+#endif
@@ -0,0 +1,39 @@
+#include "TransformBatchKernel.hpp"
+
+#ifdef TRANSFORM_BATCH_X86
+
+#include <emmintrin.h>
+
+namespace {
+  // SSE2 only, which every 64-bit x86 CPU has.
+  struct SSEOps {
+    static constexpr std::size_t WIDTH = 4;
+    using Float = __m128;
+    using Int   = __m128i;
+
+    static Float set(float value) { return _mm_set1_ps(value); }
+    static Float load(const float* src) { return _mm_loadu_ps(src); }
+    static void store(float* dst, Float value) { _mm_store_ps(dst, value); }
+    static Float add(Float a, Float b) { return _mm_add_ps(a, b); }
+    static Float sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+    static Float mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+    static Float div(Float a, Float b) { return _mm_div_ps(a, b); }
+    static Int toInt(Float value) { return _mm_cvtps_epi32(value); } // Rounds to nearest.
+    static Float toFloat(Int value) { return _mm_cvtepi32_ps(value); }
+    static Int addInt(Int a, int32_t b) { return _mm_add_epi32(a, _mm_set1_epi32(b)); }
+    static Float bitTest(Int value, int32_t bit)
+    {
+      __m128i bits = _mm_set1_epi32(bit);
+      return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(value, bits), bits));
+    }
+    static Float select(Float mask, Float a, Float b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+    static Float negateIf(Float value, Float mask) { return _mm_xor_ps(value, _mm_and_ps(mask, _mm_set1_ps(-0.0f))); }
+  };
+}
+
+std::size_t computeMatricesSSE(const TransformBatchData &data)
+{
+  return TransformBatchKernel::computeMatrices<SSEOps>(data);
+}
+
+#endif
@@ -6,6 +6,7 @@
 #include "PerspectiveCamera.hpp"
 #include "ModelRenderer.hpp"
 #include "TextureRenderer.hpp"
+#include "HierarchySystem.hpp"
 
 #ifdef unix
 #include <iostream>
@@ -20,7 +21,7 @@
 #include "imgui_impl_vulkan.h"
 #endif
 
-Engine::Engine() : camera(entitiesManager.addEntity())
+Engine::Engine() : scheduler(threadPool), camera(entitiesManager.addEntity())
 {
   
 }
@@ -34,11 +35,13 @@ void Engine::init()
 {
   this->printOS();
   camera.addComponent<PerspectiveCamera>();
+  scheduler.addSystem<HierarchySystem>();
 
   this->renderer->init();
   AssetPool::addTexture(this->renderer->getDevice(), "img_tex", "assets/textures/viking_room.png");
   AssetPool::addTexture(this->renderer->getDevice(), "img_tex2", "assets/textures/img.jpg");
   AssetPool::addShader(this->renderer->getDevice(), "texture", "shaders/texture_fragment_shader.spv", "shaders/texture_vertex_shader.spv");
+  AssetPool::addShader(this->renderer->getDevice(), "texture_packed", "shaders/texture_fragment_shader.spv", "shaders/texture_packed_vertex_shader.spv");
   AssetPool::addModel("model", "assets/models/viking_room.obj");
 
   for (int i = 0; i < 20; i++) {
@@ -49,9 +52,8 @@ void Engine::init()
       e.addComponent<TextureRenderer>(AssetPool::getTexture("img_tex2"));
     else
       e.addComponent<TextureRenderer>(AssetPool::getTexture("img_tex"));
-
-    this->renderer->addEntity(e);
   }
+  this->entitiesManager.printStats();
 
   this->renderer->initRendering();
   this->printDevKeyBinds();
@@ -110,6 +112,21 @@ void Engine::toggleGraphicsSettings()
     std::cout << "Sample shading setting changed to '" << this->renderer->sampleShading << "'.\n";
     this->renderer->restart();
   }
+  else if (KeyListener::isBindDown(GLFW_KEY_LEFT_SHIFT, GLFW_KEY_F4)) {
+    this->renderer->instancedRendering = !this->renderer->instancedRendering;
+    std::cout << "Instanced rendering setting changed to '" << this->renderer->instancedRendering << "'.\n";
+    this->renderer->restart();
+  }
+  else if (KeyListener::isBindDown(GLFW_KEY_LEFT_SHIFT, GLFW_KEY_F5)) {
+    this->renderer->gpuDrivenRendering = !this->renderer->gpuDrivenRendering;
+    std::cout << "GPU driven rendering setting changed to '" << this->renderer->gpuDrivenRendering << "'.\n";
+    this->renderer->restart();
+  }
+  else if (KeyListener::isBindDown(GLFW_KEY_LEFT_SHIFT, GLFW_KEY_F6)) {
+    this->renderer->occlusionCulling = !this->renderer->occlusionCulling;
+    std::cout << "Occlusion culling setting changed to '" << this->renderer->occlusionCulling << "'.\n";
+    this->renderer->restart();
+  }
 }
 
 void Engine::printDevKeyBinds()
@@ -120,6 +137,9 @@ void Engine::printDevKeyBinds()
   std::cout << "|    SHIFT + F2 -> Iterates MSAA settings (DISABLED, MSAA2X, MSAA4X,\n";
   std::cout << "|                  MSAA8X, MSAA16X, MSAA32X, MSAA64X).\n";
   std::cout << "|    SHIFT + F3 -> Toggles Sample Shading setting (False, True).\n";
+  std::cout << "|    SHIFT + F4 -> Toggles Instanced Rendering setting (False, True).\n";
+  std::cout << "|    SHIFT + F5 -> Toggles GPU Driven Rendering setting (False, True).\n";
+  std::cout << "|    SHIFT + F6 -> Toggles Occlusion Culling setting, with GPU Driven Rendering (False, True).\n";
   std::cout << " ->->->->->->->->->->->->->->->->->->->->->->->->->->->->->->->->->->->->->->\n";
 }
 
@@ -153,9 +173,13 @@ void Engine::mainLoop()
       glfwPollEvents();
 
       this->entitiesManager.update(delta);
+      this->scheduler.update(this->entitiesManager, delta);
 
       this->toggleGraphicsSettings();
 
+      // Snapshot the camera once, every rendering step reads from it.
+      this->renderer->updateFrameContext(this->camera.getComponent<PerspectiveCamera>());
+
       // Call engine logic
       accumulator = 0.0f;
       fps++;
@@ -168,6 +192,7 @@ void Engine::mainLoop()
       double vm = 0, rss = 0;
       processMemUsage(vm, rss);
       std::cout << "VM: " << vm << " kiB; RSS: " << rss << " kiB \n";
+      this->renderer->printFrameStats();
       fps = 0;
       timer = 0.0f;
     }
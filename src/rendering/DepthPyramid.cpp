@@ -0,0 +1,311 @@
+#include "DepthPyramid.hpp"
+#include "AssetPool.hpp"
+#include "Utils.hpp"
+
+#include <array>
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+  uint32_t nextPowerOfTwo(uint32_t value)
+  {
+    uint32_t power = 1;
+    while (power < value) power <<= 1;
+    return power;
+  }
+}
+
+DepthPyramid::DepthPyramid(VkDevice device, MemoryAllocator &allocator, VkQueue graphicsQueue,
+                           VkCommandPool commandPool, VkPipelineCache pipelineCache, VkImageView depthImageView,
+                           VkExtent2D depthExtent, VkSampleCountFlagBits depthSamples) :
+  depthExtent(depthExtent), depthSamplesCount(static_cast<uint32_t>(depthSamples)), cachedDevice(device),
+  cachedAllocator(allocator)
+{
+  this->extent.width  = std::max(nextPowerOfTwo(depthExtent.width) / 2, 1u);
+  this->extent.height = std::max(nextPowerOfTwo(depthExtent.height) / 2, 1u);
+
+  this->levelsCount = 1;
+  while ((std::max(this->extent.width, this->extent.height) >> this->levelsCount) > 0) this->levelsCount++;
+
+  this->createImage(graphicsQueue, commandPool);
+  this->createDescriptorSets(depthImageView);
+  this->createPipelines(pipelineCache);
+}
+
+DepthPyramid::~DepthPyramid()
+{
+  vkDestroyPipeline(cachedDevice, depthPipeline, nullptr);
+  vkDestroyPipeline(cachedDevice, reducePipeline, nullptr);
+  vkDestroyPipelineLayout(cachedDevice, pipelineLayout, nullptr);
+  vkDestroyDescriptorPool(cachedDevice, descriptorPool, nullptr);
+  vkDestroyDescriptorSetLayout(cachedDevice, descriptorSetLayout, nullptr);
+
+  vkDestroySampler(cachedDevice, sampler, nullptr);
+  for (VkImageView levelView : levelsViews) vkDestroyImageView(cachedDevice, levelView, nullptr);
+  vkDestroyImageView(cachedDevice, imageView, nullptr);
+  Utils::destroyImage(cachedDevice, image, imageAllocation, cachedAllocator);
+}
+
+void DepthPyramid::createImage(VkQueue graphicsQueue, VkCommandPool commandPool)
+{
+  VkFormat format = VK_FORMAT_R32_SFLOAT;
+  Utils::createImage(cachedDevice, cachedAllocator, this->extent.width, this->extent.height, this->levelsCount,
+                     VK_SAMPLE_COUNT_1_BIT, format, VK_IMAGE_TILING_OPTIMAL,
+                     VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, imageAllocation);
+
+  // Stays in the general layout, since every level is both written and read.
+  Utils::transitionImageLayout(cachedDevice, graphicsQueue, commandPool, image, format,
+                               VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, this->levelsCount);
+
+  this->imageView = Utils::createImageView(cachedDevice, image, format, VK_IMAGE_ASPECT_COLOR_BIT, this->levelsCount);
+
+  this->levelsViews.resize(this->levelsCount);
+  for (uint32_t level = 0; level < this->levelsCount; level++) {
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType    = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image    = image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format   = format;
+    viewInfo.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel   = level;
+    viewInfo.subresourceRange.levelCount     = 1;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount     = 1;
+
+    if (vkCreateImageView(cachedDevice, &viewInfo, nullptr, &levelsViews[level]) != VK_SUCCESS) {
+      throw std::runtime_error("Error: Failed to create depth pyramid level view.\n");
+    }
+  }
+
+  // Only read with texelFetch, so no filtering.
+  VkSamplerCreateInfo samplerInfo{};
+  samplerInfo.sType        = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  samplerInfo.magFilter    = VK_FILTER_NEAREST;
+  samplerInfo.minFilter    = VK_FILTER_NEAREST;
+  samplerInfo.mipmapMode   = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+  samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.minLod       = 0.0f;
+  samplerInfo.maxLod       = static_cast<float>(this->levelsCount);
+
+  if (vkCreateSampler(cachedDevice, &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+    throw std::runtime_error("Error: Failed to create depth pyramid sampler.\n");
+  }
+}
+
+void DepthPyramid::createDescriptorSets(VkImageView depthImageView)
+{
+  // Input level and output level.
+  std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+  bindings[0].binding         = 0;
+  bindings[0].descriptorCount = 1;
+  bindings[0].descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  bindings[0].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+  bindings[1].binding         = 1;
+  bindings[1].descriptorCount = 1;
+  bindings[1].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+  bindings[1].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+
+  VkDescriptorSetLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+  layoutInfo.pBindings    = bindings.data();
+
+  if (vkCreateDescriptorSetLayout(cachedDevice, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+    throw std::runtime_error("Error: Failed to create depth pyramid descriptor set layout.\n");
+  }
+
+  std::array<VkDescriptorPoolSize, 2> poolSizes{};
+  poolSizes[0].type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  poolSizes[0].descriptorCount = this->levelsCount;
+  poolSizes[1].type            = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+  poolSizes[1].descriptorCount = this->levelsCount;
+
+  VkDescriptorPoolCreateInfo poolInfo{};
+  poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+  poolInfo.pPoolSizes    = poolSizes.data();
+  poolInfo.maxSets       = this->levelsCount;
+
+  if (vkCreateDescriptorPool(cachedDevice, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+    throw std::runtime_error("Error: Failed to create depth pyramid descriptor pool.\n");
+  }
+
+  std::vector<VkDescriptorSetLayout> layouts(this->levelsCount, descriptorSetLayout);
+  VkDescriptorSetAllocateInfo allocInfo{};
+  allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocInfo.descriptorPool     = descriptorPool;
+  allocInfo.descriptorSetCount = this->levelsCount;
+  allocInfo.pSetLayouts        = layouts.data();
+
+  descriptorSets.resize(this->levelsCount);
+  if (vkAllocateDescriptorSets(cachedDevice, &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
+    throw std::runtime_error("Error: Failed to allocate depth pyramid descriptor sets.\n");
+  }
+
+  for (uint32_t level = 0; level < this->levelsCount; level++) {
+    // The first level reads the depth buffer, so without it its set is left empty and never bound.
+    if (level == 0 && depthImageView == VK_NULL_HANDLE) continue;
+
+    VkDescriptorImageInfo inputInfo{};
+    inputInfo.sampler = sampler;
+    if (level == 0) {
+      inputInfo.imageView   = depthImageView;
+      inputInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+    }
+    else {
+      inputInfo.imageView   = levelsViews[level - 1];
+      inputInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    }
+
+    VkDescriptorImageInfo outputInfo{};
+    outputInfo.imageView   = levelsViews[level];
+    outputInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+    std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+    descriptorWrites[0].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[0].dstSet          = descriptorSets[level];
+    descriptorWrites[0].dstBinding      = 0;
+    descriptorWrites[0].dstArrayElement = 0;
+    descriptorWrites[0].descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptorWrites[0].descriptorCount = 1;
+    descriptorWrites[0].pImageInfo      = &inputInfo;
+
+    descriptorWrites[1].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[1].dstSet          = descriptorSets[level];
+    descriptorWrites[1].dstBinding      = 1;
+    descriptorWrites[1].dstArrayElement = 0;
+    descriptorWrites[1].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    descriptorWrites[1].descriptorCount = 1;
+    descriptorWrites[1].pImageInfo      = &outputInfo;
+
+    vkUpdateDescriptorSets(cachedDevice, static_cast<uint32_t>(descriptorWrites.size()),
+                           descriptorWrites.data(), 0, nullptr);
+  }
+}
+
+void DepthPyramid::createPipelines(VkPipelineCache pipelineCache)
+{
+  // Only read by the multisampled variant.
+  VkPushConstantRange pushConstantRange{};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset     = 0;
+  pushConstantRange.size       = sizeof(int32_t);
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount         = 1;
+  pipelineLayoutInfo.pSetLayouts            = &descriptorSetLayout;
+  pipelineLayoutInfo.pushConstantRangeCount = 1;
+  pipelineLayoutInfo.pPushConstantRanges    = &pushConstantRange;
+
+  if (vkCreatePipelineLayout(cachedDevice, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+    throw std::runtime_error("Error: Failed to create depth pyramid pipeline layout.\n");
+  }
+
+  this->reducePipeline = this->createPipeline(pipelineCache, SHADER_FILEPATH);
+  this->depthPipeline  = this->createPipeline(pipelineCache, this->depthSamplesCount > 1 ? MSAA_SHADER_FILEPATH
+                                                                                           : SHADER_FILEPATH);
+}
+
+VkPipeline DepthPyramid::createPipeline(VkPipelineCache pipelineCache, const std::string &shaderFilepath)
+{
+  std::vector<char> code = AssetPool::readFile(shaderFilepath);
+
+  VkShaderModuleCreateInfo moduleInfo{};
+  moduleInfo.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  moduleInfo.codeSize = code.size();
+  moduleInfo.pCode    = reinterpret_cast<const uint32_t *>(code.data());
+
+  VkShaderModule shaderModule;
+  if (vkCreateShaderModule(cachedDevice, &moduleInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+    throw std::runtime_error("Error: Failed to create depth pyramid shader module.\n");
+  }
+
+  VkComputePipelineCreateInfo pipelineInfo{};
+  pipelineInfo.sType        = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineInfo.stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineInfo.stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineInfo.stage.module = shaderModule;
+  pipelineInfo.stage.pName  = "main";
+  pipelineInfo.layout       = pipelineLayout;
+
+  VkPipeline pipeline;
+  VkResult result = vkCreateComputePipelines(cachedDevice, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline);
+  vkDestroyShaderModule(cachedDevice, shaderModule, nullptr);
+
+  if (result != VK_SUCCESS) {
+    throw std::runtime_error("Error: Failed to create depth pyramid pipeline.\n");
+  }
+
+  return pipeline;
+}
+
+/**
+ * @brief Builds every level, one dispatch per level. The barrier after each
+ * level also covers the culling of the next frame, which is recorded later.
+ */
+void DepthPyramid::record(VkCommandBuffer commandBuffer, const glm::mat4 &viewProj)
+{
+  // This frame's culling must be done reading the pyramid before it's overwritten.
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+  int32_t samplesCount = static_cast<int32_t>(this->depthSamplesCount);
+  vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(int32_t), &samplesCount);
+
+  for (uint32_t level = 0; level < this->levelsCount; level++) {
+    uint32_t width  = std::max(this->extent.width >> level, 1u);
+    uint32_t height = std::max(this->extent.height >> level, 1u);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, level == 0 ? depthPipeline : reducePipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1,
+                            &descriptorSets[level], 0, nullptr);
+    vkCmdDispatch(commandBuffer, (width + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, (height + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1);
+
+    VkMemoryBarrier barrier{};
+    barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0, 1, &barrier, 0, nullptr, 0, nullptr);
+  }
+
+  this->viewProj = viewProj;
+  this->built = true;
+}
+
+// Getters and Setters
+
+VkImageView DepthPyramid::getImageView()
+{
+  return this->imageView;
+}
+
+VkSampler DepthPyramid::getSampler()
+{
+  return this->sampler;
+}
+
+VkExtent2D DepthPyramid::getDepthExtent()
+{
+  return this->depthExtent;
+}
+
+uint32_t DepthPyramid::getLevelsCount()
+{
+  return this->levelsCount;
+}
+
+const glm::mat4 &DepthPyramid::getViewProj() const
+{
+  return this->viewProj;
+}
+
+bool DepthPyramid::isBuilt() const
+{
+  return this->built;
+}
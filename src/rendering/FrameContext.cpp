@@ -0,0 +1,50 @@
+#include "FrameContext.hpp"
+#include "PerspectiveCamera.hpp"
+
+#include <cmath>
+
+/**
+ * @brief Computes every camera matrix of the frame.
+ *
+ * @param aspectRatio Width / height of the swap chain's images.
+ * @param viewportHeight Height of the swap chain's images, in pixels.
+ */
+void FrameContext::update(PerspectiveCamera &camera, float aspectRatio, float viewportHeight)
+{
+  this->view = camera.getViewMatrix();
+  this->proj = glm::perspective(glm::radians(camera.getFoV()), aspectRatio, camera.zNear, camera.zFar);
+  // Vulkan's Y axis points down.
+  this->proj[1][1] *= -1;
+
+  this->viewProj = this->proj * this->view;
+  this->cameraPosition = camera.position;
+  this->projectionScale = std::abs(this->proj[1][1]) * viewportHeight * 0.5f;
+
+  this->extractFrustumPlanes();
+}
+
+/**
+ * @brief Gets the frustum planes straight from the view-projection matrix
+ * (Gribb & Hartmann). The near plane is taken as if depth went from -1 to 1,
+ * which is slightly looser than Vulkan's 0 to 1 range, so it never culls
+ * anything that is visible.
+ */
+void FrameContext::extractFrustumPlanes()
+{
+  // glm is column-major, so build the rows first.
+  glm::vec4 rows[4];
+  for (int i = 0; i < 4; i++) {
+    rows[i] = glm::vec4(this->viewProj[0][i], this->viewProj[1][i], this->viewProj[2][i], this->viewProj[3][i]);
+  }
+
+  this->frustumPlanes[LEFT_PLANE]   = rows[3] + rows[0];
+  this->frustumPlanes[RIGHT_PLANE]  = rows[3] - rows[0];
+  this->frustumPlanes[BOTTOM_PLANE] = rows[3] + rows[1];
+  this->frustumPlanes[TOP_PLANE]    = rows[3] - rows[1];
+  this->frustumPlanes[NEAR_PLANE]   = rows[3] + rows[2];
+  this->frustumPlanes[FAR_PLANE]    = rows[3] - rows[2];
+
+  for (glm::vec4 &plane : this->frustumPlanes) {
+    plane /= glm::length(glm::vec3(plane));
+  }
+}
@@ -0,0 +1,122 @@
+#include "FrustumCuller.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64)
+  #define FRUSTUM_CULLER_SSE
+  #include <emmintrin.h> // SSE2 is part of every 64-bit x86 CPU.
+#endif
+
+void FrustumCuller::resize(std::size_t count)
+{
+  std::size_t paddedCount = (count + 3) & ~std::size_t(3);
+
+  this->localCenters.assign(count, glm::vec3(0.0f));
+  this->localRadii.assign(count, 0.0f);
+
+  this->centersX.assign(paddedCount, 0.0f);
+  this->centersY.assign(paddedCount, 0.0f);
+  this->centersZ.assign(paddedCount, 0.0f);
+  this->radii.assign(paddedCount, -std::numeric_limits<float>::infinity());
+  this->visible.assign(paddedCount, 0);
+}
+
+void FrustumCuller::setLocalBounds(std::size_t object, const Model::Bounds &bounds)
+{
+  this->localCenters[object] = bounds.sphereCenter;
+  this->localRadii[object]   = bounds.sphereRadius;
+}
+
+/**
+ * @brief Moves the object's sphere to world space. The radius is scaled by the
+ * longest axis of the matrix, so the sphere stays conservative under
+ * non-uniform scales.
+ */
+void FrustumCuller::updateWorldBounds(std::size_t object, const glm::mat4 &modelMatrix)
+{
+  glm::vec4 center = modelMatrix * glm::vec4(this->localCenters[object], 1.0f);
+  float maxScale = std::max({ glm::length(glm::vec3(modelMatrix[0])),
+                              glm::length(glm::vec3(modelMatrix[1])),
+                              glm::length(glm::vec3(modelMatrix[2])) });
+
+  this->centersX[object] = center.x;
+  this->centersY[object] = center.y;
+  this->centersZ[object] = center.z;
+  this->radii[object]    = this->localRadii[object] * maxScale;
+}
+
+void FrustumCuller::hide(std::size_t object)
+{
+  this->radii[object] = -std::numeric_limits<float>::infinity();
+}
+
+void FrustumCuller::cull(const FrameContext &frameContext, ThreadPool &threadPool)
+{
+  threadPool.parallelFor(this->radii.size(), GRAIN_SIZE, [this, &frameContext](std::size_t begin, std::size_t end) {
+    this->cullRange(frameContext, begin, end);
+  });
+}
+
+/**
+ * @brief A sphere is visible unless it is entirely behind one of the planes,
+ * i.e. dot(normal, center) + distance < -radius for some plane. Both ends of
+ * the range are multiples of 4.
+ */
+void FrustumCuller::cullRange(const FrameContext &frameContext, std::size_t begin, std::size_t end)
+{
+  const std::array<glm::vec4, 6> &planes = frameContext.frustumPlanes;
+
+#ifdef FRUSTUM_CULLER_SSE
+  __m128 planesX[6], planesY[6], planesZ[6], planesW[6];
+  for (int p = 0; p < 6; p++) {
+    planesX[p] = _mm_set1_ps(planes[p].x);
+    planesY[p] = _mm_set1_ps(planes[p].y);
+    planesZ[p] = _mm_set1_ps(planes[p].z);
+    planesW[p] = _mm_set1_ps(planes[p].w);
+  }
+
+  const __m128 signMask = _mm_set1_ps(-0.0f);
+  for (std::size_t i = begin; i < end; i += 4) {
+    __m128 x = _mm_loadu_ps(&this->centersX[i]);
+    __m128 y = _mm_loadu_ps(&this->centersY[i]);
+    __m128 z = _mm_loadu_ps(&this->centersZ[i]);
+    __m128 negRadius = _mm_xor_ps(_mm_loadu_ps(&this->radii[i]), signMask);
+
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (int p = 0; p < 6; p++) {
+      __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, planesX[p]), _mm_mul_ps(y, planesY[p])),
+                                   _mm_add_ps(_mm_mul_ps(z, planesZ[p]), planesW[p]));
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+    }
+
+    int mask = _mm_movemask_ps(inside);
+    this->visible[i]     = (mask >> 0) & 1;
+    this->visible[i + 1] = (mask >> 1) & 1;
+    this->visible[i + 2] = (mask >> 2) & 1;
+    this->visible[i + 3] = (mask >> 3) & 1;
+  }
+#else
+  for (std::size_t i = begin; i < end; i++) {
+    bool inside = true;
+    for (int p = 0; p < 6 && inside; p++) {
+      float distance = this->centersX[i] * planes[p].x + this->centersY[i] * planes[p].y +
+                       this->centersZ[i] * planes[p].z + planes[p].w;
+      inside = distance >= -this->radii[i];
+    }
+    this->visible[i] = inside;
+  }
+#endif
+}
+
+// Getters and Setters
+
+bool FrustumCuller::isVisible(std::size_t object) const
+{
+  return this->visible[object] != 0;
+}
+
+glm::vec4 FrustumCuller::getWorldSphere(std::size_t object) const
+{
+  return glm::vec4(this->centersX[object], this->centersY[object], this->centersZ[object], this->radii[object]);
+}
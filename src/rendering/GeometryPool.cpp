@@ -0,0 +1,279 @@
+#include "GeometryPool.hpp"
+#include "Utils.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <iostream>
+#include <stdexcept>
+
+bool GeometryPool::Allocation::isValid() const
+{
+  return this->arena != UINT32_MAX;
+}
+
+GeometryPool::GeometryPool(VkDevice device, MemoryAllocator &allocator, UploadBatch &uploadBatch) :
+  cachedDevice(device), cachedAllocator(allocator), cachedUploadBatch(uploadBatch)
+{
+
+}
+
+GeometryPool::~GeometryPool()
+{
+  for (Arena &arena : this->arenas) {
+    Utils::destroyBuffer(cachedDevice, arena.buffer, arena.bufferAllocation, cachedAllocator);
+  }
+}
+
+GeometryPool::Allocation GeometryPool::allocate(Usage usage, uint32_t elementSize, const void* data, uint32_t count)
+{
+  return this->allocate(usage, elementSize, count, [data, elementSize, count](void* mapped) {
+    std::memcpy(mapped, data, static_cast<size_t>(count) * elementSize);
+  });
+}
+
+GeometryPool::Allocation GeometryPool::allocate(Usage usage, uint32_t elementSize, uint32_t count,
+                                                const std::function<void(void*)> &write)
+{
+  Allocation allocation{};
+  Arena &arena = this->findArena(usage, elementSize, allocation.arena);
+
+  uint32_t offset = 0;
+  if (count > 0 && !this->takeHole(arena, count, offset)) {
+    // Packing the arena is enough when the holes add up to the range. Otherwise it doubles too.
+    uint32_t capacity = arena.capacity;
+    if (arena.capacity - arena.usedCount < count) capacity = std::max(arena.capacity * 2, arena.usedCount + count);
+    this->relocate(arena, capacity);
+    this->takeHole(arena, count, offset);
+  }
+
+  if (!arena.unusedRanges.empty()) {
+    allocation.range = arena.unusedRanges.back();
+    arena.unusedRanges.pop_back();
+  }
+  else {
+    allocation.range = static_cast<uint32_t>(arena.ranges.size());
+    arena.ranges.push_back({});
+  }
+  arena.ranges[allocation.range] = { offset, count, true };
+  arena.usedCount += count;
+
+  if (count > 0) this->upload(arena, offset, count, write);
+  return allocation;
+}
+
+void GeometryPool::free(Allocation allocation)
+{
+  if (!allocation.isValid()) return;
+
+  Arena &arena = this->arenas[allocation.arena];
+  Range &range = arena.ranges[allocation.range];
+  if (range.count > 0) this->addHole(arena, range.offset, range.count);
+
+  arena.usedCount -= range.count;
+  range.live = false;
+  this->rangesFreed = true;
+  arena.unusedRanges.push_back(allocation.range);
+}
+
+bool GeometryPool::compact()
+{
+  bool moved = false;
+  for (Arena &arena : this->arenas) {
+    // Packed arenas have at most one hole, at their end.
+    bool packed = arena.holes.empty() ||
+                  (arena.holes.size() == 1 && arena.holes.begin()->first == arena.usedCount);
+    if (packed) continue;
+
+    this->relocate(arena, arena.capacity);
+    moved = true;
+  }
+
+  return moved;
+}
+
+/**
+ * @brief Finds the arena with the usage and element size, or creates it with
+ * an empty buffer of ARENA_SIZE bytes.
+ */
+GeometryPool::Arena &GeometryPool::findArena(Usage usage, uint32_t elementSize, uint32_t &arenaIndex)
+{
+  for (uint32_t i = 0; i < this->arenas.size(); i++) {
+    if (this->arenas[i].usage == usage && this->arenas[i].elementSize == elementSize) {
+      arenaIndex = i;
+      return this->arenas[i];
+    }
+  }
+
+  arenaIndex = static_cast<uint32_t>(this->arenas.size());
+  this->arenas.push_back({});
+  Arena &arena = this->arenas.back();
+  arena.usage       = usage;
+  arena.elementSize = elementSize;
+  arena.capacity    = static_cast<uint32_t>(std::max<VkDeviceSize>(ARENA_SIZE / elementSize, 1));
+  this->createBuffer(arena, arena.capacity, arena.buffer, arena.bufferAllocation);
+  arena.holes[0] = arena.capacity;
+
+  return arena;
+}
+
+void GeometryPool::createBuffer(const Arena &arena, uint32_t capacity, VkBuffer &buffer,
+                                MemoryAllocator::Allocation &bufferAllocation)
+{
+  // Also a transfer source, so the arena can be packed into a new buffer.
+  VkBufferUsageFlags usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+  usage |= arena.usage == Usage::VERTICES ? VK_BUFFER_USAGE_VERTEX_BUFFER_BIT : VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+
+  Utils::createBuffer(static_cast<VkDeviceSize>(capacity) * arena.elementSize, usage,
+                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, bufferAllocation,
+                      cachedDevice, cachedAllocator);
+}
+
+// Takes the range from the first hole it fits in.
+bool GeometryPool::takeHole(Arena &arena, uint32_t count, uint32_t &offset)
+{
+  for (auto holeObj = arena.holes.begin(); holeObj != arena.holes.end(); holeObj++) {
+    if (holeObj->second < count) continue;
+
+    offset = holeObj->first;
+    uint32_t remainingCount = holeObj->second - count;
+    arena.holes.erase(holeObj);
+    if (remainingCount > 0) arena.holes[offset + count] = remainingCount;
+    return true;
+  }
+
+  return false;
+}
+
+// Gives the range back, merged with the holes right before and after it.
+void GeometryPool::addHole(Arena &arena, uint32_t offset, uint32_t count)
+{
+  auto nextObj = arena.holes.lower_bound(offset);
+  if (nextObj != arena.holes.end() && nextObj->first == offset + count) {
+    count += nextObj->second;
+    nextObj = arena.holes.erase(nextObj);
+  }
+
+  if (nextObj != arena.holes.begin()) {
+    auto previousObj = std::prev(nextObj);
+    if (previousObj->first + previousObj->second == offset) {
+      previousObj->second += count;
+      return;
+    }
+  }
+
+  arena.holes[offset] = count;
+}
+
+/**
+ * @brief Copies the live ranges of the arena one after another into a new
+ * buffer of capacity elements, keeping their order, and leaves a single hole
+ * after them.
+ */
+void GeometryPool::relocate(Arena &arena, uint32_t capacity)
+{
+  VkBuffer buffer;
+  MemoryAllocator::Allocation bufferAllocation;
+  this->createBuffer(arena, capacity, buffer, bufferAllocation);
+
+  std::vector<uint32_t> order;
+  for (uint32_t i = 0; i < arena.ranges.size(); i++) {
+    if (arena.ranges[i].live && arena.ranges[i].count > 0) order.push_back(i);
+  }
+  std::sort(order.begin(), order.end(), [&arena](uint32_t a, uint32_t b) {
+    return arena.ranges[a].offset < arena.ranges[b].offset;
+  });
+
+  std::vector<VkBufferCopy> copyRegions;
+  uint32_t offset = 0;
+  for (uint32_t i : order) {
+    Range &range = arena.ranges[i];
+    VkDeviceSize srcOffset = static_cast<VkDeviceSize>(range.offset) * arena.elementSize;
+    VkDeviceSize dstOffset = static_cast<VkDeviceSize>(offset) * arena.elementSize;
+    VkDeviceSize size      = static_cast<VkDeviceSize>(range.count) * arena.elementSize;
+
+    // Ranges that were already together are copied at once.
+    if (!copyRegions.empty() && copyRegions.back().srcOffset + copyRegions.back().size == srcOffset) {
+      copyRegions.back().size += size;
+    }
+    else {
+      copyRegions.push_back({ srcOffset, dstOffset, size });
+    }
+
+    range.offset = offset;
+    offset += range.count;
+  }
+
+  // Uploads to the old buffer still in the batch land before it's copied. Waiting for the batch also waits for
+  // every frame still drawing from the old buffer, since they were submitted to the same queue before it.
+  if (!copyRegions.empty()) {
+    cachedUploadBatch.transferBarrier();
+    vkCmdCopyBuffer(cachedUploadBatch.getCommandBuffer(), arena.buffer, buffer,
+                    static_cast<uint32_t>(copyRegions.size()), copyRegions.data());
+  }
+  cachedUploadBatch.wait();
+
+  Utils::destroyBuffer(cachedDevice, arena.buffer, arena.bufferAllocation, cachedAllocator);
+  arena.buffer           = buffer;
+  arena.bufferAllocation = bufferAllocation;
+  arena.capacity         = capacity;
+
+  arena.holes.clear();
+  if (offset < capacity) arena.holes[offset] = capacity - offset;
+
+  this->generation++;
+}
+
+void GeometryPool::upload(const Arena &arena, uint32_t offset, uint32_t count, const std::function<void(void*)> &write)
+{
+  VkDeviceSize size = static_cast<VkDeviceSize>(count) * arena.elementSize;
+
+  StagingBuffer::Region region = cachedUploadBatch.stage(size);
+  write(region.mapped);
+
+  // The range may be a freed one that an earlier copy of the batch is still writing to.
+  if (this->rangesFreed) {
+    cachedUploadBatch.transferBarrier();
+    this->rangesFreed = false;
+  }
+
+  VkBufferCopy copyRegion{};
+  copyRegion.srcOffset = region.offset;
+  copyRegion.dstOffset = static_cast<VkDeviceSize>(offset) * arena.elementSize;
+  copyRegion.size      = size;
+  vkCmdCopyBuffer(cachedUploadBatch.getCommandBuffer(), region.buffer, arena.buffer, 1, &copyRegion);
+}
+
+void GeometryPool::printStats()
+{
+  for (const Arena &arena : this->arenas) {
+    uint32_t rangesCount = static_cast<uint32_t>(arena.ranges.size() - arena.unusedRanges.size());
+    std::cout << "INFO: Geometry pool " << (arena.usage == Usage::VERTICES ? "vertices" : "indices") << " of "
+              << arena.elementSize << " bytes: " << rangesCount << " range(s), "
+              << static_cast<VkDeviceSize>(arena.usedCount) * arena.elementSize / 1024 << " of "
+              << static_cast<VkDeviceSize>(arena.capacity) * arena.elementSize / 1024 << " KiB used, "
+              << arena.holes.size() << " hole(s).\n";
+  }
+}
+
+// Getters and Setters
+
+VkBuffer GeometryPool::getBuffer(Allocation allocation) const
+{
+  return this->arenas[allocation.arena].buffer;
+}
+
+uint32_t GeometryPool::getOffset(Allocation allocation) const
+{
+  return this->arenas[allocation.arena].ranges[allocation.range].offset;
+}
+
+uint32_t GeometryPool::getCount(Allocation allocation) const
+{
+  return this->arenas[allocation.arena].ranges[allocation.range].count;
+}
+
+uint32_t GeometryPool::getGeneration() const
+{
+  return this->generation;
+}
@@ -0,0 +1,325 @@
+#include "GpuCuller.hpp"
+#include "AssetPool.hpp"
+#include "Engine.hpp"
+#include "Utils.hpp"
+
+#include <array>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+GpuCuller::GpuCuller(VkDevice device, VkPhysicalDevice physicalDevice, MemoryAllocator &allocator,
+                     VkPipelineCache pipelineCache, SceneDataBuffer* sceneDataBuffer, uint32_t drawsCount) :
+  cachedDevice(device), cachedAllocator(allocator), objectsCount(sceneDataBuffer->getCapacity())
+{
+  this->draws.assign(std::max(drawsCount, 1u), VkDrawIndexedIndirectCommand{});
+  this->culls.assign(this->objectsCount, CullData{});
+  this->pendingCulls.resize(MAX_FRAMES_IN_FLIGHT);
+
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+  VkDeviceSize alignment = properties.limits.minStorageBufferOffsetAlignment;
+
+  // An empty storage buffer range isn't valid in Vulkan.
+  VkDeviceSize cullsSize = sizeof(CullData) * std::max(this->objectsCount, 1u);
+  this->statsOffset = (sizeof(VkDrawIndexedIndirectCommand) * this->draws.size() + alignment - 1) & ~(alignment - 1);
+  VkDeviceSize drawsSize = this->statsOffset + sizeof(CullStats);
+
+  cullsBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+  cullsBuffersAllocations.resize(MAX_FRAMES_IN_FLIGHT);
+  cullsMapped.resize(MAX_FRAMES_IN_FLIGHT);
+  drawsBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+  drawsBuffersAllocations.resize(MAX_FRAMES_IN_FLIGHT);
+  drawsMapped.resize(MAX_FRAMES_IN_FLIGHT);
+  statsMapped.resize(MAX_FRAMES_IN_FLIGHT);
+  paramsBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+  paramsBuffersAllocations.resize(MAX_FRAMES_IN_FLIGHT);
+  paramsMapped.resize(MAX_FRAMES_IN_FLIGHT);
+
+  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    Utils::createBuffer(cullsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                        cullsBuffers[i], cullsBuffersAllocations[i], device, allocator);
+    cullsMapped[i] = static_cast<CullData*>(cullsBuffersAllocations[i].mapped);
+    std::memset(cullsMapped[i], 0, cullsSize);
+
+    Utils::createBuffer(drawsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                        drawsBuffers[i], drawsBuffersAllocations[i], device, allocator);
+    drawsMapped[i] = static_cast<VkDrawIndexedIndirectCommand*>(drawsBuffersAllocations[i].mapped);
+    statsMapped[i] = reinterpret_cast<CullStats*>(reinterpret_cast<char*>(drawsMapped[i]) + this->statsOffset);
+    *statsMapped[i] = CullStats{};
+
+    Utils::createBuffer(sizeof(CullParams), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                        paramsBuffers[i], paramsBuffersAllocations[i], device, allocator);
+    paramsMapped[i] = static_cast<CullParams*>(paramsBuffersAllocations[i].mapped);
+  }
+
+  VkDeviceSize lodsSize = sizeof(uint32_t) * std::max(this->objectsCount, 1u);
+  Utils::createBuffer(lodsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                      lodsBuffer, lodsBufferAllocation, device, allocator);
+  std::memset(lodsBufferAllocation.mapped, 0, lodsSize);
+
+  this->createDescriptorSets(sceneDataBuffer);
+  this->createPipeline(pipelineCache);
+}
+
+GpuCuller::~GpuCuller()
+{
+  vkDestroyPipeline(cachedDevice, pipeline, nullptr);
+  vkDestroyPipelineLayout(cachedDevice, pipelineLayout, nullptr);
+  vkDestroyDescriptorPool(cachedDevice, descriptorPool, nullptr);
+  vkDestroyDescriptorSetLayout(cachedDevice, descriptorSetLayout, nullptr);
+
+  Utils::destroyBuffer(cachedDevice, lodsBuffer, lodsBufferAllocation, cachedAllocator);
+  for (size_t i = 0; i < cullsBuffers.size(); i++) {
+    Utils::destroyBuffer(cachedDevice, cullsBuffers[i], cullsBuffersAllocations[i], cachedAllocator);
+    Utils::destroyBuffer(cachedDevice, drawsBuffers[i], drawsBuffersAllocations[i], cachedAllocator);
+    Utils::destroyBuffer(cachedDevice, paramsBuffers[i], paramsBuffersAllocations[i], cachedAllocator);
+  }
+}
+
+void GpuCuller::createDescriptorSets(SceneDataBuffer* sceneDataBuffer)
+{
+  // Objects, culls, draws, instances, params, depth pyramid, stats and levels of detail.
+  std::array<VkDescriptorSetLayoutBinding, 8> bindings{};
+  for (uint32_t i = 0; i < bindings.size(); i++) {
+    bindings[i].binding         = i;
+    bindings[i].descriptorCount = 1;
+    bindings[i].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[i].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+  }
+  bindings[4].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+  bindings[5].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+  VkDescriptorSetLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+  layoutInfo.pBindings    = bindings.data();
+
+  if (vkCreateDescriptorSetLayout(cachedDevice, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+    throw std::runtime_error("Error: Failed to create culling descriptor set layout.\n");
+  }
+
+  std::array<VkDescriptorPoolSize, 3> poolSizes{};
+  poolSizes[0].type            = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSizes[0].descriptorCount = static_cast<uint32_t>(6 * MAX_FRAMES_IN_FLIGHT);
+  poolSizes[1].type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+  poolSizes[1].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+  poolSizes[2].type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  poolSizes[2].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+
+  VkDescriptorPoolCreateInfo poolInfo{};
+  poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+  poolInfo.pPoolSizes    = poolSizes.data();
+  poolInfo.maxSets       = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+
+  if (vkCreateDescriptorPool(cachedDevice, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+    throw std::runtime_error("Error: Failed to create culling descriptor pool.\n");
+  }
+
+  std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, descriptorSetLayout);
+  VkDescriptorSetAllocateInfo allocInfo{};
+  allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocInfo.descriptorPool     = descriptorPool;
+  allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+  allocInfo.pSetLayouts        = layouts.data();
+
+  descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+  if (vkAllocateDescriptorSets(cachedDevice, &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
+    throw std::runtime_error("Error: Failed to allocate culling descriptor sets.\n");
+  }
+
+  // The depth pyramid is written by setDepthPyramid().
+  for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    std::array<VkDescriptorBufferInfo, 7> buffersInfos{};
+    buffersInfos[0] = { sceneDataBuffer->getBuffer(i), sceneDataBuffer->getObjectsOffset(), sceneDataBuffer->getObjectsRange() };
+    buffersInfos[1] = { cullsBuffers[i], 0, VK_WHOLE_SIZE };
+    buffersInfos[2] = { drawsBuffers[i], 0, sizeof(VkDrawIndexedIndirectCommand) * this->draws.size() };
+    buffersInfos[3] = { sceneDataBuffer->getBuffer(i), sceneDataBuffer->getInstancesOffset(), sceneDataBuffer->getInstancesRange() };
+    buffersInfos[4] = { paramsBuffers[i], 0, sizeof(CullParams) };
+    buffersInfos[5] = { drawsBuffers[i], this->statsOffset, sizeof(CullStats) };
+    buffersInfos[6] = { lodsBuffer, 0, VK_WHOLE_SIZE };
+
+    const std::array<uint32_t, 7> bufferBindings = { 0, 1, 2, 3, 4, 6, 7 };
+    std::array<VkWriteDescriptorSet, 7> descriptorWrites{};
+    for (uint32_t j = 0; j < descriptorWrites.size(); j++) {
+      descriptorWrites[j].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      descriptorWrites[j].dstSet          = descriptorSets[i];
+      descriptorWrites[j].dstBinding      = bufferBindings[j];
+      descriptorWrites[j].dstArrayElement = 0;
+      descriptorWrites[j].descriptorType  = bindings[bufferBindings[j]].descriptorType;
+      descriptorWrites[j].descriptorCount = 1;
+      descriptorWrites[j].pBufferInfo     = &buffersInfos[j];
+    }
+
+    vkUpdateDescriptorSets(cachedDevice, static_cast<uint32_t>(descriptorWrites.size()),
+                           descriptorWrites.data(), 0, nullptr);
+  }
+}
+
+void GpuCuller::createPipeline(VkPipelineCache pipelineCache)
+{
+  std::vector<char> code = AssetPool::readFile(SHADER_FILEPATH);
+
+  VkShaderModuleCreateInfo moduleInfo{};
+  moduleInfo.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  moduleInfo.codeSize = code.size();
+  moduleInfo.pCode    = reinterpret_cast<const uint32_t *>(code.data());
+
+  VkShaderModule shaderModule;
+  if (vkCreateShaderModule(cachedDevice, &moduleInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+    throw std::runtime_error("Error: Failed to create culling shader module.\n");
+  }
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType          = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = 1;
+  pipelineLayoutInfo.pSetLayouts    = &descriptorSetLayout;
+
+  if (vkCreatePipelineLayout(cachedDevice, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+    vkDestroyShaderModule(cachedDevice, shaderModule, nullptr);
+    throw std::runtime_error("Error: Failed to create culling pipeline layout.\n");
+  }
+
+  VkComputePipelineCreateInfo pipelineInfo{};
+  pipelineInfo.sType        = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineInfo.stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineInfo.stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineInfo.stage.module = shaderModule;
+  pipelineInfo.stage.pName  = "main";
+  pipelineInfo.layout       = pipelineLayout;
+
+  VkResult result = vkCreateComputePipelines(cachedDevice, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline);
+  vkDestroyShaderModule(cachedDevice, shaderModule, nullptr);
+
+  if (result != VK_SUCCESS) {
+    throw std::runtime_error("Error: Failed to create culling pipeline.\n");
+  }
+}
+
+void GpuCuller::setObject(uint32_t object, const Model &model, uint32_t firstDraw)
+{
+  const Model::Bounds &bounds = model.getBounds();
+  glm::vec4 lodErrors(0.0f);
+  for (uint32_t i = 0; i < model.getLodsCount(); i++) lodErrors[i] = model.getLod(i).error;
+
+  CullData &cull = this->culls[object];
+  cull.sphere    = glm::vec4(bounds.sphereCenter, bounds.sphereRadius);
+  cull.lodErrors = lodErrors;
+  cull.firstDraw = firstDraw;
+  cull.lodsCount = model.getLodsCount();
+
+  for (std::vector<uint32_t> &pending : this->pendingCulls) pending.push_back(object);
+}
+
+void GpuCuller::setDraw(uint32_t drawIndex, const Model &model, uint32_t lod, uint32_t firstInstance)
+{
+  VkDrawIndexedIndirectCommand &draw = this->draws[drawIndex];
+  draw.indexCount    = model.getLod(lod).indicesCount;
+  draw.instanceCount = 0;
+  draw.firstIndex    = model.getFirstIndex() + model.getLod(lod).firstIndex;
+  draw.vertexOffset  = model.getVertexOffset();
+  draw.firstInstance = firstInstance;
+}
+
+void GpuCuller::hide(uint32_t object)
+{
+  // Destroyed entities are hidden again every frame.
+  if (this->culls[object].sphere.w < 0.0f) return;
+
+  this->culls[object].sphere.w = -1.0f;
+  for (std::vector<uint32_t> &pending : this->pendingCulls) pending.push_back(object);
+}
+
+/**
+ * @brief Resets this frame's draws and dispatches the culling shader. The
+ * last barrier makes the draws and instances visible to the indirect draws and
+ * vertex shaders that follow, and the stats visible to the host.
+ */
+void GpuCuller::record(VkCommandBuffer commandBuffer, uint32_t currentFrame, const FrameContext &frameContext, bool occlusionCulling)
+{
+  // The frame's fence was waited on, so the GPU is done with these culls, draws and stats.
+  for (uint32_t object : this->pendingCulls[currentFrame]) this->cullsMapped[currentFrame][object] = this->culls[object];
+  this->pendingCulls[currentFrame].clear();
+
+  std::memcpy(this->drawsMapped[currentFrame], this->draws.data(), sizeof(VkDrawIndexedIndirectCommand) * this->draws.size());
+  this->stats = *this->statsMapped[currentFrame];
+  *this->statsMapped[currentFrame] = CullStats{};
+
+  CullParams* params = this->paramsMapped[currentFrame];
+  for (int i = 0; i < 6; i++) params->frustumPlanes[i] = frameContext.frustumPlanes[i];
+  params->pyramidViewProj    = this->depthPyramid->getViewProj();
+  params->depthSize          = glm::ivec2(this->depthPyramid->getDepthExtent().width, this->depthPyramid->getDepthExtent().height);
+  params->pyramidLevelsCount = static_cast<int32_t>(this->depthPyramid->getLevelsCount());
+  params->objectsCount       = this->objectsCount;
+  params->occlusionCulling   = occlusionCulling && this->depthPyramid->isBuilt();
+  params->cameraPosition     = frameContext.cameraPosition;
+  params->projectionScale    = frameContext.projectionScale;
+
+  // The levels of detail were written by the previous frame's culling.
+  VkMemoryBarrier lodsBarrier{};
+  lodsBarrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  lodsBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  lodsBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       0, 1, &lodsBarrier, 0, nullptr, 0, nullptr);
+
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1,
+                          &descriptorSets[currentFrame], 0, nullptr);
+  vkCmdDispatch(commandBuffer, (this->objectsCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+  VkMemoryBarrier barrier{};
+  barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+                       0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+// Getters and Setters
+
+void GpuCuller::setDepthPyramid(DepthPyramid* depthPyramid)
+{
+  this->depthPyramid = depthPyramid;
+
+  VkDescriptorImageInfo pyramidInfo{};
+  pyramidInfo.sampler     = depthPyramid->getSampler();
+  pyramidInfo.imageView   = depthPyramid->getImageView();
+  pyramidInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+  for (VkDescriptorSet descriptorSet : this->descriptorSets) {
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet          = descriptorSet;
+    descriptorWrite.dstBinding      = 5;
+    descriptorWrite.dstArrayElement = 0;
+    descriptorWrite.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pImageInfo      = &pyramidInfo;
+
+    vkUpdateDescriptorSets(cachedDevice, 1, &descriptorWrite, 0, nullptr);
+  }
+}
+
+VkBuffer GpuCuller::getDrawsBuffer(uint32_t currentFrame)
+{
+  return this->drawsBuffers[currentFrame];
+}
+
+VkDeviceSize GpuCuller::getDrawOffset(uint32_t drawIndex)
+{
+  return sizeof(VkDrawIndexedIndirectCommand) * drawIndex;
+}
+
+const GpuCuller::CullStats &GpuCuller::getStats() const
+{
+  return this->stats;
+}
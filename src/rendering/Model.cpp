@@ -4,11 +4,18 @@
 #include "Utils.hpp"
 
 #include <memory>
+#include <cmath>
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
 #include <cstring>
 #include <stdexcept>
+#include <limits>
 
 Model::Model(const std::string FILEPATH, const std::vector<Vertex> &vertices,  
-             std::vector<uint32_t> indices) : FILEPATH(FILEPATH), cachedDevice(Engine::get()->getRenderer()->getDevice())
+             std::vector<uint32_t> indices, const std::vector<Lod> &lods, const Bounds &bounds,
+             VertexFormat vertexFormat)
+  : FILEPATH(FILEPATH), lods(lods), bounds(bounds), vertexFormat(vertexFormat),
+    cachedDevice(Engine::get()->getRenderer()->getDevice())
 {
   this->vertices = vertices;
   this->indices  = indices;
@@ -16,103 +23,137 @@ Model::Model(const std::string FILEPATH, const std::vector<Vertex> &vertices,
 
 Model::~Model()
 {
-  vkDestroyBuffer(cachedDevice, indexBuffer, nullptr);
-  vkFreeMemory(cachedDevice, indexBufferMemory, nullptr);
+  // Never initialized otherwise.
+  if (this->geometryPool == nullptr) return;
 
-  vkDestroyBuffer(cachedDevice, vertexBuffer, nullptr);
-  vkFreeMemory(cachedDevice, vertexBufferMemory, nullptr);
+  this->geometryPool->free(this->vertexAllocation);
+  this->geometryPool->free(this->indexAllocation);
 }
 
 void Model::init()
 {
+  this->geometryPool = Engine::get()->getRenderer()->getGeometryPool();
+
   this->createVertexBuffer(vertices);
+  this->indexType = chooseIndexType(vertices.size());
   this->createIndexBuffer(indices);
-  this->indicesCount = indices.size();
+  this->indicesCount = this->lods[0].indicesCount;
 
   this->indices.clear();
   this->vertices.clear();
 }
 
-void Model::createVertexBuffer(const std::vector<Vertex> &vertices)
+/**
+ * @brief Quantizes the vertices into packedVertices. The positions are
+ * normalized to the bounding box, which the vertex shader gets back through
+ * the PackedData, along with the color every vertex shares.
+ */
+void Model::packVertices(const std::vector<Vertex> &vertices, PackedVertex* packedVertices)
 {
-  VkDevice device = Engine::get()->getRenderer()->getDevice();
-  VkPhysicalDevice physicalDevice = Engine::get()->getRenderer()->getPhysicalDevice();
-  VkCommandPool commandPool = Engine::get()->getRenderer()->getCommandPool();
-  VkQueue graphicsQueue = Engine::get()->getRenderer()->getGraphicsQueue();
-
-  VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
-
-  // Create staging buffer
-  VkBuffer stagingBuffer;
-  VkDeviceMemory stagingBufferMemory;
-
-  Utils::createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
-               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
-               stagingBuffer, stagingBufferMemory, device, physicalDevice);
-
-  // Copy the vertex data to the buffer.
-  void* data;
-  vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-  memcpy(data, vertices.data(), static_cast<size_t>(bufferSize));
-  vkUnmapMemory(device, stagingBufferMemory);
-
-  Utils::createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, 
-               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, 
-               vertexBufferMemory, device, physicalDevice);
-
-  Utils::copyBuffer(device, commandPool, graphicsQueue, stagingBuffer, vertexBuffer, bufferSize);
-
-  vkDestroyBuffer(device, stagingBuffer, nullptr);
-  vkFreeMemory(device, stagingBufferMemory, nullptr);
+  glm::vec3 extent = this->bounds.max - this->bounds.min;
+  this->packedData.positionOffset = glm::vec4(this->bounds.min, 0.0f);
+  this->packedData.positionScale  = glm::vec4(extent, 0.0f);
+  this->packedData.color          = glm::vec4(vertices.empty() ? glm::vec3(1.0f) : vertices[0].color, 1.0f);
+
+  // Flat axes would divide by 0.
+  glm::vec3 inverseExtent = glm::vec3(extent.x > 0.0f ? 1.0f / extent.x : 0.0f,
+                                      extent.y > 0.0f ? 1.0f / extent.y : 0.0f,
+                                      extent.z > 0.0f ? 1.0f / extent.z : 0.0f);
+
+  for (size_t i = 0; i < vertices.size(); i++) {
+    const Vertex &vertex = vertices[i];
+
+    // Octahedral encoding: the normal is projected on an octahedron, whose
+    // lower half is folded over the upper one.
+    glm::vec3 normal = vertex.normalCoords;
+    float length1 = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    glm::vec2 octahedral = length1 > 0.0f ? glm::vec2(normal.x, normal.y) / length1 : glm::vec2(0.0f);
+    if (normal.z < 0.0f) {
+      glm::vec2 signs(octahedral.x >= 0.0f ? 1.0f : -1.0f, octahedral.y >= 0.0f ? 1.0f : -1.0f);
+      octahedral = (1.0f - glm::abs(glm::vec2(octahedral.y, octahedral.x))) * signs;
+    }
+
+    packedVertices[i].position  = glm::packUnorm4x16(glm::vec4((vertex.pos - this->bounds.min) * inverseExtent, 0.0f));
+    packedVertices[i].normal    = glm::packSnorm2x16(octahedral);
+    packedVertices[i].texCoords = glm::packHalf2x16(vertex.texCoords);
+  }
 }
 
-void Model::createIndexBuffer(const std::vector<uint32_t> indices)
+// The vertices get a range of the geometry pool's buffer for their format. Packed ones are written straight
+// into the staging memory.
+void Model::createVertexBuffer(const std::vector<Vertex> &vertices)
 {
-  VkDevice device  = Engine::get()->getRenderer()->getDevice();
-  VkPhysicalDevice physicalDevice = Engine::get()->getRenderer()->getPhysicalDevice();
-  VkCommandPool commandPool = Engine::get()->getRenderer()->getCommandPool();
-  VkQueue graphicsQueue = Engine::get()->getRenderer()->getGraphicsQueue();
-
-  VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
-
-  VkBuffer stagingBuffer;
-  VkDeviceMemory stagingBufferMemory;
-  
-  Utils::createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
-               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
-               stagingBuffer, stagingBufferMemory, 
-               device, physicalDevice);
-
-  void* data;
-  vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-  memcpy(data, indices.data(), (size_t) bufferSize);
-  vkUnmapMemory(device, stagingBufferMemory);
-
-  Utils::createBuffer(bufferSize, 
-               VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, 
-               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferMemory, 
-               device, physicalDevice);
-
-  Utils::copyBuffer(device, commandPool, graphicsQueue, stagingBuffer, indexBuffer, bufferSize);
+  uint32_t verticesCount = static_cast<uint32_t>(vertices.size());
+
+  if (this->vertexFormat == VertexFormat::PACKED) {
+    this->vertexBufferSize = sizeof(PackedVertex) * vertices.size();
+    this->vertexAllocation = this->geometryPool->allocate(GeometryPool::Usage::VERTICES, sizeof(PackedVertex),
+                                                          verticesCount, [this, &vertices](void* mapped) {
+      this->packVertices(vertices, static_cast<PackedVertex*>(mapped));
+    });
+    return;
+  }
+
+  this->vertexBufferSize = sizeof(Vertex) * vertices.size();
+  this->vertexAllocation = this->geometryPool->allocate(GeometryPool::Usage::VERTICES, sizeof(Vertex), vertices.data(),
+                                                        verticesCount);
+}
 
-  vkDestroyBuffer(device, stagingBuffer, nullptr);
-  vkFreeMemory(device, stagingBufferMemory, nullptr);
+// Same for the indices, narrowed to 16 bits, also straight into the staging memory, when they fit.
+void Model::createIndexBuffer(const std::vector<uint32_t> &indices)
+{
+  uint32_t indicesCount = static_cast<uint32_t>(indices.size());
+
+  if (this->indexType == VK_INDEX_TYPE_UINT16) {
+    this->indexBufferSize = sizeof(uint16_t) * indices.size();
+    this->indexAllocation = this->geometryPool->allocate(GeometryPool::Usage::INDICES, sizeof(uint16_t),
+                                                         indicesCount, [&indices](void* mapped) {
+      std::copy(indices.begin(), indices.end(), static_cast<uint16_t*>(mapped));
+    });
+    return;
+  }
+
+  this->indexBufferSize = sizeof(uint32_t) * indices.size();
+  this->indexAllocation = this->geometryPool->allocate(GeometryPool::Usage::INDICES, sizeof(uint32_t),
+                                                       indices.data(), indicesCount);
 }
 
-VkVertexInputBindingDescription Model::Vertex::getBindingDescription()
+VkVertexInputBindingDescription Model::Vertex::getBindingDescription(VertexFormat format)
 {
   VkVertexInputBindingDescription bindingDescription{};
 
   bindingDescription.binding   = 0; // Specify the index of the binding in the array of bindings.
-  bindingDescription.stride    = sizeof(Vertex); // Specify the number of bytes from one entry to the next.
+  bindingDescription.stride    = format == VertexFormat::PACKED ? sizeof(PackedVertex) : sizeof(Vertex); // Specify the number of bytes from one entry to the next.
   bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX; // Move to the next data entry after each vertex.
 
   return bindingDescription;
 }
 
-std::array<VkVertexInputAttributeDescription, 4> Model::Vertex::getAttributeDescriptions()
+std::vector<VkVertexInputAttributeDescription> Model::Vertex::getAttributeDescriptions(VertexFormat format)
 {
-  std::array<VkVertexInputAttributeDescription, 4> attributeDescriptions{};
+  // The packed attributes keep the same locations, so both shaders agree on them.
+  if (format == VertexFormat::PACKED) {
+    std::vector<VkVertexInputAttributeDescription> attributeDescriptions(3);
+
+    attributeDescriptions[0].binding  = 0;
+    attributeDescriptions[0].location = 0;
+    attributeDescriptions[0].format   = VK_FORMAT_R16G16B16A16_UNORM;
+    attributeDescriptions[0].offset   = offsetof(PackedVertex, position);
+
+    attributeDescriptions[1].binding  = 0;
+    attributeDescriptions[1].location = 2;
+    attributeDescriptions[1].format   = VK_FORMAT_R16G16_SFLOAT;
+    attributeDescriptions[1].offset   = offsetof(PackedVertex, texCoords);
+
+    attributeDescriptions[2].binding  = 0;
+    attributeDescriptions[2].location = 3;
+    attributeDescriptions[2].format   = VK_FORMAT_R16G16_SNORM;
+    attributeDescriptions[2].offset   = offsetof(PackedVertex, normal);
+
+    return attributeDescriptions;
+  }
+
+  std::vector<VkVertexInputAttributeDescription> attributeDescriptions(4);
 
   // Position attribute.
   attributeDescriptions[0].binding  = 0; // Tell Vulkan from which binding the per-vertex data comes.
@@ -142,50 +183,145 @@ std::array<VkVertexInputAttributeDescription, 4> Model::Vertex::getAttributeDesc
   return attributeDescriptions;
 }
 
+size_t Model::Vertex::getLayoutHash(VertexFormat format)
+{
+  VkVertexInputBindingDescription bindingDescription = getBindingDescription(format);
+  size_t seed = std::hash<uint32_t>()(bindingDescription.stride) ^ 
+                (std::hash<uint32_t>()(static_cast<uint32_t>(bindingDescription.inputRate)) << 1);
+
+  for (const auto &attribute : getAttributeDescriptions(format)) {
+    size_t attributeHash = std::hash<uint32_t>()(attribute.location) ^
+                           (std::hash<uint32_t>()(static_cast<uint32_t>(attribute.format)) << 1) ^
+                           (std::hash<uint32_t>()(attribute.offset) << 2);
+    seed ^= attributeHash + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+  }
+
+  return seed;
+}
+
 bool Model::Vertex::operator==(const Model::Vertex& other) const
 {
   return pos == other.pos && color == other.color && texCoords == other.texCoords;
 }
 
-void Model::bind(VkCommandBuffer commandBuffer)
+void Model::bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, GeometryPool::Bindings &bindings)
 {
-  VkBuffer vertexBuffers[] = {this->vertexBuffer};
-  VkDeviceSize offsets[] = {0};
-  vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets); // Bind vertex buffers to bindings.
-  vkCmdBindIndexBuffer(commandBuffer, this->indexBuffer, 0, VK_INDEX_TYPE_UINT32); // Bind index buffers.
+  if (this->vertexFormat == VertexFormat::PACKED) {
+    vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PackedData), &this->packedData);
+  }
+
+  // Models in the same arenas share the buffers, and their draws select their ranges instead.
+  VkBuffer vertexBuffer = this->getVertexBuffer();
+  if (vertexBuffer != bindings.vertexBuffer) {
+    VkBuffer vertexBuffers[] = {vertexBuffer};
+    VkDeviceSize offsets[] = {0};
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets); // Bind vertex buffers to bindings.
+    bindings.vertexBuffer = vertexBuffer;
+  }
+
+  VkBuffer indexBuffer = this->getIndexBuffer();
+  if (indexBuffer != bindings.indexBuffer || this->indexType != bindings.indexType) {
+    vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, this->indexType); // Bind index buffers.
                                                          // VK_INDEX_TYPE_UINT16 or VK_INDEX_TYPE_UINT32
                                                          // depending the type of the
                                                          // indices.
+    bindings.indexBuffer = indexBuffer;
+    bindings.indexType   = this->indexType;
+  }
 }
 
-void Model::draw(VkCommandBuffer commandBuffer)
+void Model::draw(VkCommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance, uint32_t lod)
 {
-  vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(this->indicesCount), 1, 0, 0, 0);
+  vkCmdDrawIndexed(commandBuffer, this->lods[lod].indicesCount, instanceCount, this->getFirstIndex() + this->lods[lod].firstIndex,
+                   this->getVertexOffset(), firstInstance);
+}
+
+/**
+ * @brief Draws with the VkDrawIndexedIndirectCommand at drawOffset, whose
+ * instance count is only known by the GPU.
+ */
+void Model::drawIndirect(VkCommandBuffer commandBuffer, VkBuffer drawsBuffer, VkDeviceSize drawOffset)
+{
+  vkCmdDrawIndexedIndirect(commandBuffer, drawsBuffer, drawOffset, 1, sizeof(VkDrawIndexedIndirectCommand));
 }
 
 // Getters and Setters
 
-VkBuffer Model::getVertexBuffer()
+VkBuffer Model::getVertexBuffer() const
 {
-  return this->vertexBuffer;
+  return this->geometryPool->getBuffer(this->vertexAllocation);
 }
 
-VkDeviceMemory Model::getVertexBufferMemory()
+VkBuffer Model::getIndexBuffer() const
 {
-  return this->vertexBufferMemory;
+  return this->geometryPool->getBuffer(this->indexAllocation);
 }
 
-VkBuffer Model::getIndexBuffer()
+int32_t Model::getVertexOffset() const
 {
-  return this->indexBuffer;
+  return static_cast<int32_t>(this->geometryPool->getOffset(this->vertexAllocation));
 }
 
-VkDeviceMemory Model::getIndexBufferMemory()
+uint32_t Model::getFirstIndex() const
 {
-  return this->indexBufferMemory;
+  return this->geometryPool->getOffset(this->indexAllocation);
 }
 
 uint32_t Model::getIndicesCount()
 {
   return this->indicesCount;
 }
+
+uint32_t Model::getLodsCount() const
+{
+  return static_cast<uint32_t>(this->lods.size());
+}
+
+const Model::Lod &Model::getLod(uint32_t lod) const
+{
+  return this->lods[lod];
+}
+
+const Model::Bounds &Model::getBounds() const
+{
+  return this->bounds;
+}
+
+Model::VertexFormat Model::getVertexFormat() const
+{
+  return this->vertexFormat;
+}
+
+VkDeviceSize Model::getVertexBufferSize() const
+{
+  return this->vertexBufferSize;
+}
+
+VkIndexType Model::getIndexType() const
+{
+  return this->indexType;
+}
+
+VkDeviceSize Model::getIndexBufferSize() const
+{
+  return this->indexBufferSize;
+}
+
+VkIndexType Model::chooseIndexType(size_t verticesCount)
+{
+  return verticesCount <= std::numeric_limits<uint16_t>::max() + size_t(1) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+}
+
+uint32_t Model::selectLod(float screenRadius, uint32_t currentLod) const
+{
+  uint32_t lod = std::min(currentLod, static_cast<uint32_t>(this->lods.size()) - 1);
+
+  // Refines as soon as the error shows, but only coarsens once it is well hidden.
+  while (lod > 0 && this->lods[lod].error * screenRadius > LOD_PIXEL_ERROR) lod--;
+  while (lod + 1 < this->lods.size() &&
+         this->lods[lod + 1].error * screenRadius <= LOD_PIXEL_ERROR * (1.0f - LOD_HYSTERESIS)) {
+    lod++;
+  }
+
+  return lod;
+}
@@ -52,11 +52,6 @@ Pipeline::Pipeline(VkDevice device, VkRenderPass renderPass) : cachedDevice(devi
 
 Pipeline::~Pipeline()
 {
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    vkDestroyBuffer(cachedDevice, uniformBuffers[i], nullptr);
-    vkFreeMemory(cachedDevice, uniformBuffersMemory[i], nullptr);
-  }
-
   vkDestroyPipeline(cachedDevice, graphicsPipeline, nullptr);
   vkDestroyPipelineLayout(cachedDevice, pipelineLayout, nullptr);
 
@@ -68,10 +63,17 @@ void Pipeline::bind(VkCommandBuffer commandBuffer)
   vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->graphicsPipeline);
 }
 
-void Pipeline::createGraphicsPipeline(VkDevice device, VkFormat swapChainImageFormat, 
-                                      VkRenderPass renderPass, VkSampleCountFlagBits msaaSamples)
+/**
+ * @brief Builds the graphics pipeline described by the key.
+ *
+ * @param vkPipelineCache Driver cache used to avoid recompiling shaders that were already compiled.
+ * @param creationFeedback If not null, it is filled through VK_EXT_pipeline_creation_feedback,
+ *                         telling if the pipeline came out of the cache.
+ */
+void Pipeline::createGraphicsPipeline(VkDevice device, const PipelineKey &key, VkPipelineCache vkPipelineCache,
+                                      VkPipelineCreationFeedbackEXT* creationFeedback)
 {
-  std::shared_ptr shader = AssetPool::getShader("texture");
+  std::shared_ptr shader = AssetPool::getShader(key.shaderID);
 
   // Create shaders' modules
   VkShaderModule fragShaderModule = shader->compile(device, shader->getFragmentShaderCode());
@@ -103,8 +105,8 @@ void Pipeline::createGraphicsPipeline(VkDevice device, VkFormat swapChainImageFo
   vertexInputInfo.pVertexAttributeDescriptions = nullptr;
 
   // Set up the graphics pipeline to accept vertex data.
-  auto bindingDescription = Model::Vertex::getBindingDescription();
-  auto attributeDescriptions = Model::Vertex::getAttributeDescriptions();
+  auto bindingDescription = Model::Vertex::getBindingDescription(key.vertexFormat);
+  auto attributeDescriptions = Model::Vertex::getAttributeDescriptions(key.vertexFormat);
   vertexInputInfo.vertexBindingDescriptionCount   = 1;
   vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
   vertexInputInfo.pVertexBindingDescriptions      = &bindingDescription;
@@ -123,10 +125,10 @@ void Pipeline::createGraphicsPipeline(VkDevice device, VkFormat swapChainImageFo
   viewportState.viewportCount = 1;
   viewportState.scissorCount = 1;
 
-  VkPipelineRasterizationStateCreateInfo rasterizer = this->setupRasterizationStage();
+  VkPipelineRasterizationStateCreateInfo rasterizer = this->setupRasterizationStage(key);
   
   // Multisampling --is one of the ways to perform anti-aliasing.
-  VkPipelineMultisampleStateCreateInfo multisampling = this->setupMultisample(msaaSamples);
+  VkPipelineMultisampleStateCreateInfo multisampling = this->setupMultisample(key.msaaSamples, key.sampleShading);
 
   VkPipelineDepthStencilStateCreateInfo depthStencil{};
   depthStencil.sType                 = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
@@ -156,8 +158,14 @@ void Pipeline::createGraphicsPipeline(VkDevice device, VkFormat swapChainImageFo
   pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
   pipelineLayoutInfo.setLayoutCount         = 1;
   pipelineLayoutInfo.pSetLayouts            = this->descriptorLayout->getDescriptorSetLayoutPointer();
-  pipelineLayoutInfo.pushConstantRangeCount = 0;
-  pipelineLayoutInfo.pPushConstantRanges    = nullptr;
+  // Packed models push their Model::PackedData. Every pipeline gets the range, whatever its vertex format.
+  VkPushConstantRange pushConstantRange{};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+  pushConstantRange.offset     = 0;
+  pushConstantRange.size       = sizeof(Model::PackedData);
+
+  pipelineLayoutInfo.pushConstantRangeCount = 1;
+  pipelineLayoutInfo.pPushConstantRanges    = &pushConstantRange;
 
   if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
     throw std::runtime_error("Error: Failed to create pipeline layout.\n");
@@ -179,13 +187,22 @@ void Pipeline::createGraphicsPipeline(VkDevice device, VkFormat swapChainImageFo
 
   pipelineInfo.layout = pipelineLayout;
 
-  pipelineInfo.renderPass = renderPass;
+  pipelineInfo.renderPass = key.renderPass;
   pipelineInfo.subpass = 0;
 
   pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
   pipelineInfo.basePipelineIndex = -1;
 
-  if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
+  VkPipelineCreationFeedbackCreateInfoEXT creationFeedbackInfo{};
+  if (creationFeedback != nullptr) {
+    creationFeedbackInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT;
+    creationFeedbackInfo.pPipelineCreationFeedback          = creationFeedback;
+    creationFeedbackInfo.pipelineStageCreationFeedbackCount = 0;
+    creationFeedbackInfo.pPipelineStageCreationFeedbacks    = nullptr;
+    pipelineInfo.pNext = &creationFeedbackInfo;
+  }
+
+  if (vkCreateGraphicsPipelines(device, vkPipelineCache, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
     throw std::runtime_error("Error: Failed to create graphics pipeline.\n");
   }
 
@@ -194,7 +211,7 @@ void Pipeline::createGraphicsPipeline(VkDevice device, VkFormat swapChainImageFo
   vkDestroyShaderModule(device, vertShaderModule, nullptr);
 }
 
-VkPipelineMultisampleStateCreateInfo Pipeline::setupMultisample(VkSampleCountFlagBits msaaSamples)
+VkPipelineMultisampleStateCreateInfo Pipeline::setupMultisample(VkSampleCountFlagBits msaaSamples, bool sampleShading)
 {
   VkPipelineMultisampleStateCreateInfo multisampling = {};
   multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
@@ -203,7 +220,7 @@ VkPipelineMultisampleStateCreateInfo Pipeline::setupMultisample(VkSampleCountFla
   multisampling.alphaToCoverageEnable = VK_FALSE;
   multisampling.alphaToOneEnable      = VK_FALSE;
 
-  if (Engine::get()->getRenderer()->sampleShading) {
+  if (sampleShading) {
     multisampling.sampleShadingEnable = VK_TRUE; // enable sample shading in the pipeline
     multisampling.minSampleShading    = .2f; // min fraction for sample shading; closer to one is smoother
   }
@@ -224,10 +241,11 @@ VkPipelineMultisampleStateCreateInfo Pipeline::setupMultisample(VkSampleCountFla
  * In this function it will be setup a "VkPipelineRasterizationStateCreateInfo"
  * to handle this job.
  * 
+ * @param key Pipeline key that holds the polygon, cull and front face modes.
  * @return VkPipelineRasterizationStateCreateInfo returns the configured
  *         "VkPipelineRasterizationStateCreateInfo".
  */
-VkPipelineRasterizationStateCreateInfo Pipeline::setupRasterizationStage()
+VkPipelineRasterizationStateCreateInfo Pipeline::setupRasterizationStage(const PipelineKey &key)
 {
   VkPipelineRasterizationStateCreateInfo rasterizer{};
   rasterizer.sType                   = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -243,14 +261,14 @@ VkPipelineRasterizationStateCreateInfo Pipeline::setupRasterizationStage()
   // If true, primitives are discarded immediatly befora the rasterization stage.
   rasterizer.rasterizerDiscardEnable = VK_FALSE;
   // Determines how fragments are generated for geometry.
-  rasterizer.polygonMode             = VK_POLYGON_MODE_FILL;
+  rasterizer.polygonMode             = key.polygonMode;
 
   rasterizer.lineWidth               = 1.0f;
 
   // Tell if the indices will be followed up by counter-clockwise mode
   // or followed up by clockwise mode.
-  rasterizer.cullMode                = VK_CULL_MODE_BACK_BIT;
-  rasterizer.frontFace               = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+  rasterizer.cullMode                = key.cullMode;
+  rasterizer.frontFace               = key.frontFace;
 
   rasterizer.depthBiasEnable         = VK_FALSE;
   rasterizer.depthBiasConstantFactor = 0.0f;
@@ -260,61 +278,6 @@ VkPipelineRasterizationStateCreateInfo Pipeline::setupRasterizationStage()
   return rasterizer;
 }
 
-void Pipeline::updateUniformBuffer(uint32_t currentFrame, int modelRendererIndex)
-{
-  UniformBufferObject ubo{};
-
-  if (Engine::get()->getRenderer()->getEntity(modelRendererIndex)) {
-    const Entity& e = Engine::get()->getRenderer()->getEntity(modelRendererIndex).value();
-    ubo.model = e.getComponent<Transform>().getModelMatrix();
-  }
-  else {
-    ubo.model = glm::translate(glm::vec3(0, 0, 0));
-  }
-
-  ubo.view = Engine::get()->getCamera().getComponent<PerspectiveCamera>().getViewMatrix();
-  ubo.proj = glm::perspective(glm::radians(Engine::get()->getCamera().getComponent<PerspectiveCamera>().getFoV()), 
-                              Engine::get()->getRenderer()->getSwapChain()->getSwapChainExtent().width / 
-                              static_cast<float>(Engine::get()->getRenderer()->getSwapChain()->getSwapChainExtent().height), 
-                              Engine::get()->getCamera().getComponent<PerspectiveCamera>().zNear, 
-                              Engine::get()->getCamera().getComponent<PerspectiveCamera>().zFar);
-
-  if (Engine::get()->getRenderer()->getEntity(modelRendererIndex)) {
-    const Entity& e = Engine::get()->getRenderer()->getEntity(modelRendererIndex).value();
-    ubo.normalMatrix = e.getComponent<Transform>().getNormalMatrix();
-  }
-  else {
-    ubo.normalMatrix = glm::identity<glm::mat3>();
-  }
-
-  ubo.proj[1][1] *= -1;
-
-  memcpy(uniformBuffersMapped[currentFrame], &ubo, sizeof(ubo));
-}
-
-void Pipeline::createUniformBuffers()
-{
-  VkDeviceSize bufferSize = sizeof(Pipeline::UniformBufferObject);
-
-  uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-  uniformBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
-  uniformBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
-
-  VkDevice device = Engine::get()->getRenderer()->getDevice();
-  VkPhysicalDevice physicalDevice = Engine::get()->getRenderer()->getPhysicalDevice();
-
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    Utils::createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, 
-                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
-                 uniformBuffers[i], uniformBuffersMemory[i], device, physicalDevice);
-
-    // Map the buffer right after creation using vkMapMemory to get a pointer to 
-    // which we can write the data later on.
-    // This technique is called "persistent mapping".
-    vkMapMemory(device, uniformBuffersMemory[i], 0, bufferSize, 0, &uniformBuffersMapped[i]);
-  }
-}
-
 VkPipelineLayout Pipeline::getPipelineLayout()
 {
   return this->pipelineLayout;
@@ -329,8 +292,3 @@ const std::unique_ptr<DescriptorLayout> &Pipeline::getDescriptorLayout() const
 {
   return this->descriptorLayout;
 }
-
-const std::vector<VkBuffer> Pipeline::getUniformBuffers()
-{
-  return this->uniformBuffers;
-}
\ No newline at end of file
@@ -0,0 +1,222 @@
+#include "PipelineCache.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <chrono>
+#include <stdexcept>
+
+PipelineCache::PipelineCache(VkDevice device, VkPhysicalDevice physicalDevice, const std::string filepath, bool creationFeedback) :
+  cachedDevice(device), filepath(filepath), creationFeedback(creationFeedback)
+{
+  vkGetPhysicalDeviceProperties(physicalDevice, &cachedProperties);
+
+  std::vector<char> initialData = this->loadFile();
+  this->loadedFromDisk = !initialData.empty();
+
+  VkPipelineCacheCreateInfo createInfo{};
+  createInfo.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  createInfo.initialDataSize = initialData.size();
+  createInfo.pInitialData    = initialData.empty() ? nullptr : initialData.data();
+
+  if (vkCreatePipelineCache(device, &createInfo, nullptr, &vkPipelineCache) != VK_SUCCESS) {
+    // The driver may still refuse the data, so try again with an empty cache.
+    createInfo.initialDataSize = 0;
+    createInfo.pInitialData    = nullptr;
+    this->loadedFromDisk = false;
+
+    if (vkCreatePipelineCache(device, &createInfo, nullptr, &vkPipelineCache) != VK_SUCCESS) {
+      throw std::runtime_error("Error: Failed to create pipeline cache.\n");
+    }
+  }
+
+  if (this->loadedFromDisk)
+    std::cout << "INFO: Loaded pipeline cache '" << filepath << "' (" << initialData.size() << " bytes).\n";
+  else
+    std::cout << "INFO: Starting with an empty pipeline cache.\n";
+}
+
+PipelineCache::~PipelineCache()
+{
+  this->printStats();
+  this->clear();
+  this->save();
+
+  vkDestroyPipelineCache(cachedDevice, vkPipelineCache, nullptr);
+}
+
+/**
+ * @brief Reads the pipeline cache file and checks if it has been written by
+ * this same device and driver. Data from another GPU or driver version is
+ * useless at best, so it is discarded.
+ *
+ * @return std::vector<char> The Vulkan pipeline cache data or an empty vector.
+ */
+std::vector<char> PipelineCache::loadFile()
+{
+  std::ifstream file(filepath, std::ios::binary);
+  if (!file.is_open()) {
+    return {};
+  }
+
+  FileHeader header{};
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (!file || !this->isFileHeaderValid(header)) {
+    std::cout << "Warning: Pipeline cache '" << filepath << "' is outdated or invalid. Ignoring it.\n";
+    return {};
+  }
+
+  // Don't trust the size read from disk before knowing the file really holds that much.
+  std::streampos dataStart = file.tellg();
+  file.seekg(0, std::ios::end);
+  std::streamoff remaining = file.tellg() - dataStart;
+  file.seekg(dataStart);
+  if (!file || static_cast<uint64_t>(remaining) != header.dataSize) {
+    std::cout << "Warning: Pipeline cache '" << filepath << "' is truncated. Ignoring it.\n";
+    return {};
+  }
+
+  std::vector<char> data(header.dataSize);
+  file.read(data.data(), header.dataSize);
+  if (!file) {
+    std::cout << "Warning: Pipeline cache '" << filepath << "' is truncated. Ignoring it.\n";
+    return {};
+  }
+
+  return data;
+}
+
+bool PipelineCache::isFileHeaderValid(const FileHeader &header)
+{
+  return header.magic == FILE_MAGIC && header.version == FILE_VERSION &&
+         header.vendorID == cachedProperties.vendorID &&
+         header.deviceID == cachedProperties.deviceID &&
+         header.driverVersion == cachedProperties.driverVersion &&
+         memcmp(header.pipelineCacheUUID, cachedProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+/**
+ * @brief Writes the VkPipelineCache to disk. The file is written to a
+ * temporary path first, so a crash while saving can't leave a corrupted cache behind.
+ */
+void PipelineCache::save()
+{
+  size_t dataSize = 0;
+  if (vkGetPipelineCacheData(cachedDevice, vkPipelineCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0) {
+    return;
+  }
+
+  std::vector<char> data(dataSize);
+  if (vkGetPipelineCacheData(cachedDevice, vkPipelineCache, &dataSize, data.data()) != VK_SUCCESS) {
+    std::cout << "Warning: Couldn't retrieve pipeline cache data.\n";
+    return;
+  }
+
+  FileHeader header{};
+  header.magic         = FILE_MAGIC;
+  header.version       = FILE_VERSION;
+  header.vendorID      = cachedProperties.vendorID;
+  header.deviceID      = cachedProperties.deviceID;
+  header.driverVersion = cachedProperties.driverVersion;
+  memcpy(header.pipelineCacheUUID, cachedProperties.pipelineCacheUUID, VK_UUID_SIZE);
+  header.dataSize      = dataSize;
+
+  const std::string tmpFilepath = filepath + ".tmp";
+  {
+    std::ofstream file(tmpFilepath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+      std::cout << "Warning: Couldn't write pipeline cache '" << tmpFilepath << "'.\n";
+      return;
+    }
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(data.data(), dataSize);
+  }
+
+  // rename() already replaces the old cache atomically, except on Windows, where it fails if the file exists.
+#ifdef _WIN32
+  std::remove(filepath.c_str());
+#endif
+  if (std::rename(tmpFilepath.c_str(), filepath.c_str()) != 0) {
+    std::cout << "Warning: Couldn't replace pipeline cache '" << filepath << "'.\n";
+    return;
+  }
+
+  std::cout << "INFO: Saved pipeline cache '" << filepath << "' (" << dataSize << " bytes).\n";
+}
+
+/**
+ * @brief Gets the pipeline that matches the given key, building it only if
+ * there isn't one yet.
+ *
+ * @param key State that describes the desired pipeline.
+ * @return std::shared_ptr<Pipeline> Pipeline shared by every object with the same key.
+ */
+std::shared_ptr<Pipeline> PipelineCache::getPipeline(const PipelineKey &key)
+{
+  auto mapObj = pipelinesMap.find(key);
+  if (mapObj != pipelinesMap.end()) {
+    this->hits++;
+    return mapObj->second;
+  }
+
+  this->misses++;
+  std::shared_ptr<Pipeline> pipeline = std::make_shared<Pipeline>(cachedDevice, key.renderPass);
+
+  VkPipelineCreationFeedbackEXT feedback{};
+  auto start = std::chrono::high_resolution_clock::now();
+  pipeline->createGraphicsPipeline(cachedDevice, key, vkPipelineCache, creationFeedback ? &feedback : nullptr);
+  auto end = std::chrono::high_resolution_clock::now();
+  double elapsed = std::chrono::duration<double, std::milli>(end - start).count();
+
+  if (creationFeedback && (feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT_EXT)) {
+    if (feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT_EXT) {
+      this->driverCacheHits++;
+      this->hitsCreationTime += elapsed;
+    }
+    else {
+      this->driverCacheMisses++;
+      this->missesCreationTime += elapsed;
+    }
+  }
+  else {
+    this->unknownCreationTime += elapsed;
+  }
+
+  pipelinesMap.insert({ key, pipeline });
+
+  return pipeline;
+}
+
+void PipelineCache::clear()
+{
+  pipelinesMap.clear();
+}
+
+void PipelineCache::printStats()
+{
+  std::cout << "INFO: Pipeline cache holds " << pipelinesMap.size() << " pipeline(s) ("
+            << hits << " hit(s), " << misses << " miss(es)). Startup was "
+            << (loadedFromDisk ? "warm" : "cold") << ".\n";
+
+  if (creationFeedback) {
+    std::cout << "INFO: Driver pipeline cache: " << driverCacheHits << " hit(s) in " << hitsCreationTime << " ms, "
+              << driverCacheMisses << " miss(es) in " << missesCreationTime << " ms.\n";
+  }
+  else {
+    std::cout << "INFO: Pipeline creation took " << unknownCreationTime << " ms.\n";
+  }
+}
+
+// Getters and Setters
+
+size_t PipelineCache::getPipelinesCount()
+{
+  return this->pipelinesMap.size();
+}
+
+VkPipelineCache PipelineCache::getVkPipelineCache()
+{
+  return this->vkPipelineCache;
+}
@@ -0,0 +1,135 @@
+#include "RenderObject.hpp"
+#include "Engine.hpp"
+#include "Utils.hpp"
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+RenderObject::RenderObject(VkDevice device, std::shared_ptr<Pipeline> pipeline) : pipeline(pipeline), cachedDevice(device)
+{
+
+}
+
+RenderObject::~RenderObject()
+{
+  vkDestroyDescriptorPool(cachedDevice, descriptorPool, nullptr);
+}
+
+void RenderObject::createDescriptorPool()
+{
+  // Describe which descriptor types our descriptor sets are going to contain
+  // and how many of them, using VkDescriptorPoolSize structures.
+  std::array<VkDescriptorPoolSize, 3> poolSizes{};
+  poolSizes[0].type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+  poolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+  poolSizes[1].type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  poolSizes[1].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+  poolSizes[2].type            = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSizes[2].descriptorCount = static_cast<uint32_t>(2 * MAX_FRAMES_IN_FLIGHT); // Objects and instances.
+
+  VkDescriptorPoolCreateInfo poolInfo{};
+  poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+  poolInfo.pPoolSizes    = poolSizes.data();
+  poolInfo.flags = 0;
+
+  // Specify the maximum number of descriptor sets that may be allocated.
+  poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+
+  if (vkCreateDescriptorPool(cachedDevice, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+    throw std::runtime_error("Error: Failed to create descriptor pool.\n");
+  }
+}
+
+void RenderObject::createDescriptorSets(Texture* texture, SceneDataBuffer* sceneDataBuffer)
+{
+  // Create one descriptor set for each frame in flight, all with the same layout.
+  std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, pipeline->getDescriptorLayout()->getDescriptorSetLayout());
+  VkDescriptorSetAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocInfo.descriptorPool = descriptorPool;
+  allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+  allocInfo.pSetLayouts = layouts.data();
+
+  descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+  if (vkAllocateDescriptorSets(cachedDevice, &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
+    throw std::runtime_error("Error: Failed to allocate descriptor sets.\n");
+  }
+
+  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    // Specify the buffer and the region within it that contains the data for the descriptor.
+    VkDescriptorBufferInfo cameraBufferInfo{};
+    cameraBufferInfo.buffer = sceneDataBuffer->getBuffer(i);
+    cameraBufferInfo.offset = 0;
+    cameraBufferInfo.range = sizeof(SceneDataBuffer::CameraData);
+
+    VkDescriptorBufferInfo objectsBufferInfo{};
+    objectsBufferInfo.buffer = sceneDataBuffer->getBuffer(i);
+    objectsBufferInfo.offset = sceneDataBuffer->getObjectsOffset();
+    objectsBufferInfo.range = sceneDataBuffer->getObjectsRange();
+
+    VkDescriptorBufferInfo instancesBufferInfo{};
+    instancesBufferInfo.buffer = sceneDataBuffer->getBuffer(i);
+    instancesBufferInfo.offset = sceneDataBuffer->getInstancesOffset();
+    instancesBufferInfo.range = sceneDataBuffer->getInstancesRange();
+
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageInfo.imageView = texture->getTextureImageView();
+    imageInfo.sampler = texture->getTextureSampler();
+
+    // Update configuration of descriptors.
+    std::array<VkWriteDescriptorSet, 4> descriptorWrites{};
+
+    descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[0].dstSet = descriptorSets[i];
+    descriptorWrites[0].dstBinding = 0;
+    descriptorWrites[0].dstArrayElement = 0;
+    descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    descriptorWrites[0].descriptorCount = 1;
+    descriptorWrites[0].pBufferInfo = &cameraBufferInfo;
+
+    descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[1].dstSet = descriptorSets[i];
+    descriptorWrites[1].dstBinding = 1;
+    descriptorWrites[1].dstArrayElement = 0;
+    descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptorWrites[1].descriptorCount = 1;
+    descriptorWrites[1].pImageInfo = &imageInfo;
+
+    descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[2].dstSet = descriptorSets[i];
+    descriptorWrites[2].dstBinding = 2;
+    descriptorWrites[2].dstArrayElement = 0;
+    descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptorWrites[2].descriptorCount = 1;
+    descriptorWrites[2].pBufferInfo = &objectsBufferInfo;
+
+    descriptorWrites[3].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[3].dstSet = descriptorSets[i];
+    descriptorWrites[3].dstBinding = 3;
+    descriptorWrites[3].dstArrayElement = 0;
+    descriptorWrites[3].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptorWrites[3].descriptorCount = 1;
+    descriptorWrites[3].pBufferInfo = &instancesBufferInfo;
+
+    vkUpdateDescriptorSets(cachedDevice,
+                           static_cast<uint32_t>(descriptorWrites.size()),
+                           descriptorWrites.data(), 0, nullptr);
+  }
+}
+
+void RenderObject::bind(VkCommandBuffer commandBuffer, uint32_t currentFrame)
+{
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          pipeline->getPipelineLayout(), 0, 1,
+                          &(descriptorSets[currentFrame]), 0, nullptr);
+}
+
+// Getters and Setters
+
+const std::shared_ptr<Pipeline> &RenderObject::getPipeline() const
+{
+  return this->pipeline;
+}
@@ -1,13 +1,17 @@
 #include <unordered_map>
+#include <map>
 #include <algorithm>
 #include <optional>
 #include <iostream>
+#include <chrono>
 
 #include "Renderer.hpp"
 #include "Engine.hpp"
 
 #include "ModelRenderer.hpp"
 #include "TextureRenderer.hpp"
+#include "Transform.hpp"
+#include "Hierarchy.hpp"
 #include "Utils.hpp"
 
 #ifdef IMGUI_ENABLED
@@ -209,34 +213,36 @@ void Renderer::initVulkan()
   // this->msaaSamples = VK_SAMPLE_COUNT_1_BIT;
 
   createLogicalDevice();
+  this->memoryAllocator = std::make_unique<MemoryAllocator>(device, physicalDevice);
 }
 
 void Renderer::initRendering()
 {
-  this->swapChain = std::make_unique<SwapChain>(physicalDevice, device, surface, msaaSamples);
-  for (int i = 0; i < this->entitiesVec.size(); i++) {
-    std::unique_ptr<Pipeline> pipe = std::make_unique<Pipeline>(device, swapChain->getRenderPass());
-    pipe->createGraphicsPipeline(device, swapChain->getSwapChainImageFormat(), swapChain->getRenderPass(), this->msaaSamples);
-    this->pipelines.push_back(std::move(pipe));
-  }
+  auto start = std::chrono::high_resolution_clock::now();
+
+  this->checkGpuDrivenSupport();
+  this->swapChain = std::make_unique<SwapChain>(physicalDevice, device, surface, msaaSamples, this->needsDepthPyramid());
+  this->pipelineCache = std::make_unique<PipelineCache>(device, physicalDevice, PIPELINE_CACHE_FILEPATH, 
+                                                        pipelineCreationFeedback);
 
   createCommandPool(&commandPool, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+  this->stagingBuffer = std::make_unique<StagingBuffer>(device, *memoryAllocator);
+  this->uploadBatch = std::make_unique<UploadBatch>(device, graphicsQueue, commandPool, *stagingBuffer);
+  this->geometryPool = std::make_unique<GeometryPool>(device, *memoryAllocator, *uploadBatch);
 
   this->swapChain->createColorResources(device, physicalDevice, msaaSamples);
   this->swapChain->createDepthResources(device, physicalDevice, graphicsQueue, commandPool, msaaSamples);
   this->swapChain->createFramebuffers(device, msaaSamples);
 
-  AssetPool::loadTextures(device, physicalDevice, graphicsQueue, commandPool);
+  // Every asset's uploads go in the same batch, submitted once they're all recorded.
+  AssetPool::loadTextures(device, physicalDevice, *uploadBatch);
   AssetPool::loadModels();
+  this->uploadBatch->wait();
+  this->geometryPool->printStats();
+  this->stagingBuffer->printStats();
+  this->uploadBatch->printStats();
 
-  std::shared_ptr<Shader> shader = AssetPool::getShader("texture");
-  for (int i = 0; i < this->entitiesVec.size(); i++) {
-    this->pipelines[i]->createUniformBuffers();
-    this->pipelines[i]->getDescriptorLayout()->createDescriptorPool();
-
-    std::weak_ptr<Texture> tex = entitiesVec[i].get().getComponent<TextureRenderer>().texture;
-    this->pipelines[i]->getDescriptorLayout()->createDescriptorSets(pipelines[i].get(), tex.lock().get());
-  }
+  this->createRenderObjects();
 
   createCommandBuffers();
   this->swapChain->createSyncObjects(device);
@@ -244,11 +250,18 @@ void Renderer::initRendering()
 #ifdef IMGUI_ENABLED
   this->initGui();
 #endif
+
+  this->memoryAllocator->printStats();
+
+  auto end = std::chrono::high_resolution_clock::now();
+  std::cout << "INFO: Rendering initialization took " 
+            << std::chrono::duration<double, std::milli>(end - start).count() << " ms.\n";
 }
 
 void Renderer::restart()
 {
   // Destruction
+  this->uploadBatch->wait();
   vkDeviceWaitIdle(device);
 
 #ifdef IMGUI_ENABLED
@@ -258,40 +271,34 @@ void Renderer::restart()
   // Convert MsaaSetting enum into the VkSampleCountFlagBits enum.
   msaaSamples = static_cast<VkSampleCountFlagBits>(static_cast<int>(msaaSetting));
 
+  // Render objects hold the pipelines, so they have to go first.
+  this->renderObjects.clear();
+  this->entitiesRenderObjects.clear();
+  this->instanceBatches.clear();
+  this->gpuCuller.reset();
+  this->depthPyramid.reset();
+  this->sceneDataBuffer.reset();
+  this->pipelineCache->clear();
+
   this->swapChain.reset();
 
   std::shared_ptr<Texture> tex1 = AssetPool::getTexture("img_tex");
   tex1->clean(device);
 
-  for (int i = 0; i < this->pipelines.size(); i++) {
-    this->pipelines[i].reset();
-  }
-  this->pipelines.clear();
-
   // Recreation
-  this->swapChain = std::make_unique<SwapChain>(physicalDevice, device, surface, msaaSamples);
-  for (int i = 0; i < this->entitiesVec.size(); i++) {
-    std::unique_ptr<Pipeline> pipe = std::make_unique<Pipeline>(device, swapChain->getRenderPass());
-    pipe->createGraphicsPipeline(device, swapChain->getSwapChainImageFormat(), swapChain->getRenderPass(), this->msaaSamples);
-    this->pipelines.push_back(std::move(pipe));
-  }
+  this->checkGpuDrivenSupport();
+  this->swapChain = std::make_unique<SwapChain>(physicalDevice, device, surface, msaaSamples, this->needsDepthPyramid());
 
   this->swapChain->createColorResources(device, physicalDevice, msaaSamples);
   this->swapChain->createDepthResources(device, physicalDevice, graphicsQueue, commandPool, msaaSamples);
   this->swapChain->createFramebuffers(device, msaaSamples);
 
   std::shared_ptr<Texture> tex = AssetPool::getTexture("img_tex");
-  tex->createTextureImage(device, physicalDevice, graphicsQueue, commandPool);
+  tex->createTextureImage(device, physicalDevice, *uploadBatch);
   tex->createTextureImageView(device);
   tex->createTextureSampler(device, physicalDevice);
 
-  std::shared_ptr<Shader> shader = AssetPool::getShader("texture");
-
-  for (int i = 0; i < this->pipelines.size(); i++) {
-    this->pipelines[i]->createUniformBuffers();
-    this->pipelines[i]->getDescriptorLayout()->createDescriptorPool();
-    this->pipelines[i]->getDescriptorLayout()->createDescriptorSets(pipelines[i].get(), tex.get());
-  }
+  this->createRenderObjects();
 
   this->swapChain->createSyncObjects(device);
 
@@ -300,6 +307,365 @@ void Renderer::restart()
 #endif
 }
 
+/**
+ * @brief Turns gpuDrivenRendering off if the device can't draw indirectly
+ * starting past the first instance, which every batch but the first needs.
+ */
+void Renderer::checkGpuDrivenSupport()
+{
+  if (this->gpuDrivenRendering && !this->drawIndirectFirstInstance) {
+    std::cout << "INFO: The device doesn't support drawIndirectFirstInstance. GPU driven rendering stays off.\n";
+    this->gpuDrivenRendering = false;
+  }
+}
+
+// Only then is the depth buffer kept after the render pass and sampled.
+bool Renderer::needsDepthPyramid()
+{
+  return this->instancedRendering && this->gpuDrivenRendering && this->occlusionCulling;
+}
+
+/**
+ * @brief Builds the per-object data of every entity. Entities that end up with
+ * the same PipelineKey share a single pipeline through the pipeline cache.
+ */
+void Renderer::createRenderObjects()
+{
+  this->collectEntities();
+
+  // Each level of detail has its own range of instances.
+  this->sceneDataBuffer = std::make_unique<SceneDataBuffer>(device, physicalDevice, *memoryAllocator,
+                                                            static_cast<uint32_t>(this->entitiesVec.size()),
+                                                            static_cast<uint32_t>(this->entitiesVec.size()) * Model::MAX_LODS);
+  this->objectsData.assign(this->entitiesVec.size(), SceneDataBuffer::ObjectData{});
+  this->objectsVersions.assign(this->entitiesVec.size(), 0);
+  this->objectsFromHierarchy.assign(this->entitiesVec.size(), 0);
+  this->changedObjects.reserve(this->entitiesVec.size());
+  this->objectsLods.assign(this->entitiesVec.size(), 0);
+  this->transformBatch.reserve(this->entitiesVec.size());
+  this->frustumCuller.resize(this->entitiesVec.size());
+  std::cout << "INFO: Transform matrices are built with " << TransformBatch::getInstructionSetName() << ".\n";
+
+  if (this->instancedRendering) {
+    this->createInstanceBatches();
+    this->pipelineCache->printStats();
+
+    if (this->gpuDrivenRendering) {
+      this->gpuCuller = std::make_unique<GpuCuller>(device, physicalDevice, *memoryAllocator,
+                                                    pipelineCache->getVkPipelineCache(), this->sceneDataBuffer.get(),
+                                                    static_cast<uint32_t>(this->instanceBatches.size()) * Model::MAX_LODS);
+      this->createDepthPyramid();
+      this->setGpuDraws();
+
+      for (uint32_t i = 0; i < this->instanceBatches.size(); i++) {
+        InstanceBatch &batch = this->instanceBatches[i];
+        for (size_t j = 0; j < batch.entityIndices.size(); j++) {
+          this->gpuCuller->setObject(batch.firstInstance + static_cast<uint32_t>(j), *batch.model, i * Model::MAX_LODS);
+        }
+      }
+      std::cout << "INFO: Objects are culled on the GPU and drawn indirectly.\n";
+    }
+    return;
+  }
+
+  // The descriptor sets only differ by texture, so entities with the same pipeline and texture share them.
+  std::map<std::pair<Pipeline*, Texture*>, uint32_t> renderObjectsIndices;
+  for (int i = 0; i < this->entitiesVec.size(); i++) {
+    Entity* entity = Engine::get()->entitiesManager.getEntity(this->entitiesVec[i]);
+    std::shared_ptr<Model> model = entity->getComponent<ModelRenderer>().model.lock();
+    std::shared_ptr<Texture> texture = entity->getComponent<TextureRenderer>().texture.lock();
+
+    PipelineKey key = this->createPipelineKey("texture", model->getVertexFormat());
+    std::shared_ptr<Pipeline> pipeline = pipelineCache->getPipeline(key);
+
+    auto renderObjectObj = renderObjectsIndices.find({pipeline.get(), texture.get()});
+    if (renderObjectObj == renderObjectsIndices.end()) {
+      std::unique_ptr<RenderObject> renderObject = std::make_unique<RenderObject>(device, pipeline);
+      renderObject->createDescriptorPool();
+      renderObject->createDescriptorSets(texture.get(), this->sceneDataBuffer.get());
+
+      renderObjectObj = renderObjectsIndices.insert({ {pipeline.get(), texture.get()},
+                                                      static_cast<uint32_t>(this->renderObjects.size()) }).first;
+      this->renderObjects.push_back(std::move(renderObject));
+    }
+
+    this->entitiesRenderObjects.push_back(renderObjectObj->second);
+    this->frustumCuller.setLocalBounds(i, model->getBounds());
+  }
+  std::cout << "INFO: " << this->entitiesVec.size() << " entities share " << this->renderObjects.size()
+            << " descriptor pool(s).\n";
+
+  this->pipelineCache->printStats();
+}
+
+/**
+ * @brief Groups the entities by (Model, Texture). Each group gets a single
+ * RenderObject, for its texture, and a contiguous range of the SceneDataBuffer's
+ * objects, so the whole group is drawn with one instanced draw call.
+ */
+void Renderer::createInstanceBatches()
+{
+  std::map<std::pair<Model*, Texture*>, size_t> batchesIndices;
+  for (size_t i = 0; i < this->entitiesVec.size(); i++) {
+    Entity* entity = Engine::get()->entitiesManager.getEntity(this->entitiesVec[i]);
+    std::shared_ptr<Model> model = entity->getComponent<ModelRenderer>().model.lock();
+    std::shared_ptr<Texture> texture = entity->getComponent<TextureRenderer>().texture.lock();
+
+    auto batchObj = batchesIndices.find({model.get(), texture.get()});
+    if (batchObj != batchesIndices.end()) {
+      this->instanceBatches[batchObj->second].entityIndices.push_back(i);
+      continue;
+    }
+
+    InstanceBatch batch{};
+    batch.model = model;
+    PipelineKey key = this->createPipelineKey("texture", model->getVertexFormat());
+    batch.renderObject = std::make_unique<RenderObject>(device, pipelineCache->getPipeline(key));
+    batch.renderObject->createDescriptorPool();
+    batch.renderObject->createDescriptorSets(texture.get(), this->sceneDataBuffer.get());
+    batch.entityIndices.push_back(i);
+
+    batchesIndices.insert({ {model.get(), texture.get()}, this->instanceBatches.size() });
+    this->instanceBatches.push_back(std::move(batch));
+  }
+
+  // Lay the batches one after another in the objects array.
+  uint32_t instancesCount = 0;
+  for (InstanceBatch &batch : this->instanceBatches) {
+    batch.firstInstance = instancesCount;
+    instancesCount += static_cast<uint32_t>(batch.entityIndices.size());
+
+    for (size_t i = 0; i < batch.entityIndices.size(); i++) {
+      this->frustumCuller.setLocalBounds(batch.firstInstance + i, batch.model->getBounds());
+    }
+  }
+
+  std::cout << "INFO: " << instancesCount << " entities grouped into " << this->instanceBatches.size()
+            << " instanced draw call(s).\n";
+}
+
+/**
+ * @brief Gives every batch of the GPU culler one draw per level of detail.
+ * Set again whenever the geometry pool moves the models' ranges.
+ */
+void Renderer::setGpuDraws()
+{
+  uint32_t objectsCount = this->sceneDataBuffer->getCapacity();
+  for (uint32_t i = 0; i < this->instanceBatches.size(); i++) {
+    InstanceBatch &batch = this->instanceBatches[i];
+    for (uint32_t lod = 0; lod < batch.model->getLodsCount(); lod++) {
+      this->gpuCuller->setDraw(i * Model::MAX_LODS + lod, *batch.model, lod, lod * objectsCount + batch.firstInstance);
+    }
+  }
+  this->geometryGeneration = this->geometryPool->getGeneration();
+}
+
+/**
+ * @brief Takes this frame's camera snapshot. Must be called once per frame,
+ * after the entities have been updated and before drawFrame().
+ */
+void Renderer::updateFrameContext(PerspectiveCamera &camera)
+{
+  VkExtent2D extent = this->swapChain->getSwapChainExtent();
+  this->frameContext.update(camera, extent.width / static_cast<float>(extent.height), static_cast<float>(extent.height));
+}
+
+/**
+ * @brief Writes the camera and the matrices of every object whose Transform
+ * changed since this frame's SceneDataBuffer was last written, then culls the
+ * objects. The camera matrices come from the frame context.
+ */
+void Renderer::updateSceneData(uint32_t currentFrame)
+{
+  SceneDataBuffer::CameraData* cameraData = this->sceneDataBuffer->getCameraData(currentFrame);
+  cameraData->view     = this->frameContext.view;
+  cameraData->proj     = this->frameContext.proj;
+  cameraData->viewProj = this->frameContext.viewProj;
+
+  Manager &manager = Engine::get()->entitiesManager;
+  this->transformBatch.clear();
+  this->changedObjects.clear();
+  auto updateObject = [this, &manager](uint32_t objectIndex, EntityHandle handle) {
+    // The entity was destroyed since the render objects were built, so it
+    // isn't drawn until the next restart.
+    Entity* entity = manager.getEntity(handle);
+    if (entity == nullptr) {
+      this->frustumCuller.hide(objectIndex);
+      if (this->gpuCuller) this->gpuCuller->hide(objectIndex);
+      return;
+    }
+
+    // Transform and world versions are separate counters, so they could match by chance after
+    // a Hierarchy is added or removed. The object is then written again everywhere.
+    uint8_t fromHierarchy = entity->hasComponent<Hierarchy>() ? 1 : 0;
+    if (this->objectsFromHierarchy[objectIndex] != fromHierarchy) {
+      this->objectsFromHierarchy[objectIndex] = fromHierarchy;
+      this->objectsVersions[objectIndex] = 0;
+      for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+        this->sceneDataBuffer->getObjectsVersions(frame)[objectIndex] = 0;
+      }
+    }
+
+    // Children already have their world matrices, built by the HierarchySystem.
+    if (fromHierarchy) {
+      Hierarchy &hierarchy = entity->getComponent<Hierarchy>();
+      if (this->objectsVersions[objectIndex] == hierarchy.getWorldVersion()) return;
+      this->objectsVersions[objectIndex] = hierarchy.getWorldVersion();
+
+      this->objectsData[objectIndex].model        = hierarchy.getWorldMatrix();
+      this->objectsData[objectIndex].normalMatrix = glm::mat4(hierarchy.getWorldNormalMatrix());
+      this->changedObjects.push_back(objectIndex);
+      return;
+    }
+
+    // Static objects are built once and then left alone.
+    Transform &transform = entity->getComponent<Transform>();
+    if (this->objectsVersions[objectIndex] == transform.getVersion()) return;
+    this->objectsVersions[objectIndex] = transform.getVersion();
+
+    this->transformBatch.add(objectIndex, transform.getPosition(), transform.getRotation(), transform.getScale());
+    this->changedObjects.push_back(objectIndex);
+  };
+
+  if (this->instancedRendering) {
+    for (InstanceBatch &batch : this->instanceBatches) {
+      for (size_t i = 0; i < batch.entityIndices.size(); i++) {
+        updateObject(batch.firstInstance + static_cast<uint32_t>(i), this->entitiesVec[batch.entityIndices[i]]);
+      }
+    }
+  }
+  else {
+    for (size_t i = 0; i < this->entitiesVec.size(); i++) {
+      updateObject(static_cast<uint32_t>(i), this->entitiesVec[i]);
+    }
+  }
+
+  if (!this->objectsData.empty()) {
+    this->transformBatch.computeMatrices(&this->objectsData[0].model[0][0], &this->objectsData[0].normalMatrix[0][0],
+                                         sizeof(SceneDataBuffer::ObjectData) / sizeof(float));
+  }
+
+  // The GPU culler moves the spheres itself.
+  if (this->gpuCuller == nullptr) {
+    for (uint32_t objectIndex : this->changedObjects) {
+      this->frustumCuller.updateWorldBounds(objectIndex, this->objectsData[objectIndex].model);
+    }
+  }
+
+  // Each frame in flight has its own buffer, so an object is copied once per buffer after it changes.
+  SceneDataBuffer::ObjectData* frameObjectsData = this->sceneDataBuffer->getObjectsData(currentFrame);
+  std::vector<uint32_t> &frameObjectsVersions = this->sceneDataBuffer->getObjectsVersions(currentFrame);
+  for (size_t i = 0; i < this->objectsData.size(); i++) {
+    if (frameObjectsVersions[i] == this->objectsVersions[i]) continue;
+
+    frameObjectsData[i] = this->objectsData[i];
+    frameObjectsVersions[i] = this->objectsVersions[i];
+  }
+
+  // Otherwise the culling is recorded with the frame's commands.
+  if (this->gpuCuller == nullptr) this->cullObjects(currentFrame);
+}
+
+/**
+ * @brief Tests every object against the frustum and writes the indices of the
+ * visible ones in the SceneDataBuffer. Each level of detail of a batch packs
+ * its visible objects at the start of its own range, so it's still drawn with
+ * a single call. The range of level l starts l * objects count instances in.
+ */
+void Renderer::cullObjects(uint32_t currentFrame)
+{
+  this->frustumCuller.cull(this->frameContext, Engine::get()->threadPool);
+  this->trianglesDrawn = 0;
+  this->trianglesSaved = 0;
+
+  uint32_t* instancesData = this->sceneDataBuffer->getInstancesData(currentFrame);
+  uint32_t objectsCount = this->sceneDataBuffer->getCapacity();
+  if (this->instancedRendering) {
+    for (InstanceBatch &batch : this->instanceBatches) {
+      batch.visibleCounts.fill(0);
+      for (size_t i = 0; i < batch.entityIndices.size(); i++) {
+        uint32_t objectIndex = batch.firstInstance + static_cast<uint32_t>(i);
+        if (!this->frustumCuller.isVisible(objectIndex)) continue;
+
+        uint32_t lod = this->selectLod(objectIndex, *batch.model);
+        instancesData[lod * objectsCount + batch.firstInstance + batch.visibleCounts[lod]++] = objectIndex;
+      }
+    }
+  }
+  else {
+    // Invisible objects are skipped while recording, so every instance is its own object.
+    Manager &manager = Engine::get()->entitiesManager;
+    for (uint32_t i = 0; i < objectsCount; i++) {
+      instancesData[i] = i;
+      if (!this->frustumCuller.isVisible(i)) continue;
+
+      Entity* entity = manager.getEntity(this->entitiesVec[i]);
+      this->selectLod(i, *entity->getComponent<ModelRenderer>().model.lock());
+    }
+  }
+}
+
+/**
+ * @brief Picks the level of detail of a visible object from the size of its
+ * bounding sphere on screen, and counts the triangles it saves.
+ */
+uint32_t Renderer::selectLod(uint32_t objectIndex, const Model &model)
+{
+  glm::vec4 sphere = this->frustumCuller.getWorldSphere(objectIndex);
+  float distance = glm::length(glm::vec3(sphere) - this->frameContext.cameraPosition);
+
+  // Inside the sphere, it covers the whole screen.
+  uint32_t lod = 0;
+  if (distance > sphere.w) {
+    lod = model.selectLod(sphere.w * this->frameContext.projectionScale / distance, this->objectsLods[objectIndex]);
+  }
+  this->objectsLods[objectIndex] = lod;
+
+  uint32_t trianglesDrawn = model.getLod(lod).indicesCount / 3;
+  this->trianglesDrawn += trianglesDrawn;
+  this->trianglesSaved += model.getLod(0).indicesCount / 3 - trianglesDrawn;
+
+  return lod;
+}
+
+void Renderer::printFrameStats()
+{
+  if (this->recordedFrames == 0) return;
+
+  std::cout << "INFO: Frame preparation and recording took " << this->recordingTime / this->recordedFrames
+            << " ms on average (" << (this->gpuCuller ? "GPU" : "CPU") << " culling).\n";
+  uint64_t trianglesDrawn = this->trianglesDrawn;
+  uint64_t trianglesSaved = this->trianglesSaved;
+  if (this->gpuCuller) {
+    const GpuCuller::CullStats &stats = this->gpuCuller->getStats();
+    std::cout << "INFO: Last frame culled " << stats.frustumCulled << " object(s) outside the frustum and "
+              << stats.occlusionCulled << " occluded object(s).\n";
+    trianglesDrawn = stats.trianglesDrawn;
+    trianglesSaved = stats.trianglesSaved;
+  }
+  std::cout << "INFO: Levels of detail saved " << trianglesSaved << " of " << trianglesDrawn + trianglesSaved
+            << " triangle(s) last frame.\n";
+  this->recordingTime = 0.0;
+  this->recordedFrames = 0;
+}
+
+/**
+ * @brief Packed vertices are read by the shader's packed variant, registered
+ * under the shader's ID followed by "_packed".
+ */
+PipelineKey Renderer::createPipelineKey(const std::string &shaderID, Model::VertexFormat vertexFormat)
+{
+  PipelineKey key{};
+  key.shaderID         = vertexFormat == Model::VertexFormat::PACKED ? shaderID + "_packed" : shaderID;
+  key.vertexFormat     = vertexFormat;
+  key.vertexLayoutHash = Model::Vertex::getLayoutHash(vertexFormat);
+  key.renderPass       = this->swapChain->getRenderPass();
+  key.msaaSamples      = this->msaaSamples;
+  key.sampleShading    = this->sampleShading;
+
+  return key;
+}
+
 Renderer::~Renderer()
 {
   this->clean();
@@ -307,17 +673,27 @@ Renderer::~Renderer()
 
 void Renderer::clean()
 {
+  // Nothing recorded may be submitted after what it uploads to is destroyed.
+  this->uploadBatch->wait();
   vkDeviceWaitIdle(device);
 
 #ifdef IMGUI_ENABLED
   this->cleanGui();
 #endif
 
-  AssetPool::cleanup();
-  for (int i = 0; i < this->pipelines.size(); i++) {
-    this->pipelines[i].reset();
-  }
+  this->renderObjects.clear();
+  this->entitiesRenderObjects.clear();
+  this->instanceBatches.clear();
+  this->gpuCuller.reset();
+  this->depthPyramid.reset();
+  this->sceneDataBuffer.reset();
+  this->pipelineCache.reset();
+  AssetPool::cleanup(); // The models give their ranges back to the geometry pool.
+  this->geometryPool.reset();
+  this->uploadBatch.reset();
+  this->stagingBuffer.reset();
   this->swapChain.reset();
+  this->memoryAllocator.reset(); // Everything was sub-allocated from it, so it goes last.
 
   vkDestroyCommandPool(device, commandPool, nullptr);
 
@@ -432,6 +808,12 @@ void Renderer::createLogicalDevice()
     deviceFeatures.sampleRateShading = VK_TRUE; // Enable sample shading feature for the device.
   }
 
+  // Each level of detail of a batch is drawn indirectly from its own range of instances, selected by firstInstance.
+  VkPhysicalDeviceFeatures supportedFeatures;
+  vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+  this->drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance == VK_TRUE;
+  deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+
   // Creating Logical Device.
   VkDeviceCreateInfo createInfo{};
   createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -442,8 +824,16 @@ void Renderer::createLogicalDevice()
   createInfo.pEnabledFeatures = &deviceFeatures;
 
   // Turn on swap chain system.
-  createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-  createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+  std::vector<const char *> enabledExtensions = deviceExtensions;
+
+  // Optional: lets the pipeline cache know if a pipeline came out of the driver's cache.
+  this->pipelineCreationFeedback = isDeviceExtensionSupported(physicalDevice, VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+  if (this->pipelineCreationFeedback) {
+    enabledExtensions.push_back(VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+  }
+
+  createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+  createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
   // Guarantee compatibility with older devices and older vulkan devices.
   // Because this isn't needed anymore.
@@ -478,6 +868,20 @@ void Renderer::recreateSwapChain()
 
   this->swapChain->recreateSwapChain(device, physicalDevice, graphicsQueue, 
                                      commandPool, surface, msaaSamples);
+
+  // The depth pyramid follows the size of the depth buffer.
+  if (this->gpuCuller) this->createDepthPyramid();
+}
+
+void Renderer::createDepthPyramid()
+{
+  this->depthPyramid.reset();
+  this->depthPyramid = std::make_unique<DepthPyramid>(device, *memoryAllocator, graphicsQueue, commandPool,
+                                                      pipelineCache->getVkPipelineCache(),
+                                                      this->swapChain->isDepthSampled() ? this->swapChain->getDepthImageView()
+                                                                                        : VK_NULL_HANDLE,
+                                                      this->swapChain->getSwapChainExtent(), msaaSamples);
+  this->gpuCuller->setDepthPyramid(this->depthPyramid.get());
 }
 
 void Renderer::createCommandPool(VkCommandPool* commandPool, VkCommandPoolCreateFlags commandPoolCreateFlags)
@@ -554,6 +958,12 @@ void Renderer::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t image
   renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
   renderPassInfo.pClearValues = clearValues.data();
 
+  // Dispatches can't be recorded inside a render pass.
+  if (this->gpuCuller) {
+    if (this->geometryPool->getGeneration() != this->geometryGeneration) this->setGpuDraws();
+    this->gpuCuller->record(commandBuffer, swapChain->currentFrame, this->frameContext, this->occlusionCulling);
+  }
+
   vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
   VkViewport viewport{};
@@ -570,15 +980,68 @@ void Renderer::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t image
   scissor.extent = swapChain->getSwapChainExtent();
   vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-  // Bind Graphics Pipeline
-  for (int i = 0; i < this->entitiesVec.size(); i++) {
-    this->pipelines[i]->bind(commandBuffer);
+  if (this->instancedRendering) {
+    // One draw call per level of detail of each batch. Each one picks its own
+    // range of the instances through firstInstance. With the GPU culler, only
+    // the GPU knows how many instances survived, so every batch is drawn indirectly.
+    uint32_t objectsCount = this->sceneDataBuffer->getCapacity();
+    Pipeline* boundPipeline = nullptr;
+    GeometryPool::Bindings bindings{};
+    for (uint32_t i = 0; i < this->instanceBatches.size(); i++) {
+      InstanceBatch &batch = this->instanceBatches[i];
+      uint32_t lodsCount = batch.model->getLodsCount();
+      if (this->gpuCuller == nullptr &&
+          std::all_of(batch.visibleCounts.begin(), batch.visibleCounts.begin() + lodsCount,
+                      [](uint32_t visibleCount) { return visibleCount == 0; })) {
+        continue;
+      }
 
-    std::shared_ptr<Model> model = this->entitiesVec[i].get().getComponent<ModelRenderer>().model.lock();
-    model->bind(commandBuffer);
+      Pipeline* pipeline = batch.renderObject->getPipeline().get();
+      if (pipeline != boundPipeline) {
+        pipeline->bind(commandBuffer);
+        boundPipeline = pipeline;
+      }
+
+      batch.model->bind(commandBuffer, pipeline->getPipelineLayout(), bindings);
+      batch.renderObject->bind(commandBuffer, swapChain->currentFrame);
+      for (uint32_t lod = 0; lod < lodsCount; lod++) {
+        if (this->gpuCuller) {
+          batch.model->drawIndirect(commandBuffer, this->gpuCuller->getDrawsBuffer(swapChain->currentFrame),
+                                    this->gpuCuller->getDrawOffset(i * Model::MAX_LODS + lod));
+        }
+        else if (batch.visibleCounts[lod] > 0) {
+          batch.model->draw(commandBuffer, batch.visibleCounts[lod], lod * objectsCount + batch.firstInstance, lod);
+        }
+      }
+    }
+  }
+
+  // Bind Graphics Pipeline --only when it changes, since most entities share the same one.
+  // The same goes for the geometry pool's buffers.
+  Pipeline* boundPipeline = nullptr;
+  RenderObject* boundRenderObject = nullptr;
+  GeometryPool::Bindings bindings{};
+  for (int i = 0; i < this->entitiesRenderObjects.size(); i++) {
+    Entity* entity = Engine::get()->entitiesManager.getEntity(this->entitiesVec[i]);
+    if (entity == nullptr) continue; // Destroyed since the render objects were built.
+    if (!this->frustumCuller.isVisible(i)) continue;
+
+    RenderObject* renderObject = this->renderObjects[this->entitiesRenderObjects[i]].get();
+    Pipeline* pipeline = renderObject->getPipeline().get();
+    if (pipeline != boundPipeline) {
+      pipeline->bind(commandBuffer);
+      boundPipeline = pipeline;
+      boundRenderObject = nullptr;
+    }
+
+    std::shared_ptr<Model> model = entity->getComponent<ModelRenderer>().model.lock();
+    model->bind(commandBuffer, pipeline->getPipelineLayout(), bindings);
 
-    this->pipelines[i]->getDescriptorLayout()->bind(pipelines[i].get(), commandBuffer);
-    model->draw(commandBuffer);
+    if (renderObject != boundRenderObject) {
+      renderObject->bind(commandBuffer, swapChain->currentFrame);
+      boundRenderObject = renderObject;
+    }
+    model->draw(commandBuffer, 1, i, this->objectsLods[i]); // firstInstance selects the entity's instance.
   }
 
 #ifdef IMGUI_ENABLED
@@ -587,6 +1050,11 @@ void Renderer::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t image
 
   vkCmdEndRenderPass(commandBuffer);
 
+  // Next frame's occlusion culling reads this frame's depth.
+  if (this->depthPyramid && this->swapChain->isDepthSampled()) {
+    this->depthPyramid->record(commandBuffer, this->frameContext.viewProj);
+  }
+
   // Finished recording the command buffer.
   if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
     throw std::runtime_error("Error: Failed to record Command Buffer.\n");
@@ -611,10 +1079,13 @@ void Renderer::drawFrame()
     throw std::runtime_error("Error: Failed to acquire swap chain image.");
   }
 
-  // Update uniform buffers.
-  for (int i = 0; i < this->pipelines.size(); i++) {
-    this->pipelines[i]->updateUniformBuffer(this->swapChain->currentFrame, i);
-  }
+  auto recordingStart = std::chrono::high_resolution_clock::now();
+
+  // Uploads recorded since the last frame, e.g. streamed assets, are submitted before it.
+  this->uploadBatch->submit();
+
+  // Update the camera and objects' data, and cull the objects.
+  this->updateSceneData(this->swapChain->currentFrame);
 
   // Only reset the fence if we are submitting work.
   vkResetFences(device, 1, &(swapChain->getInFlightFences()[swapChain->currentFrame]));
@@ -622,6 +1093,10 @@ void Renderer::drawFrame()
   vkResetCommandBuffer(commandBuffers[swapChain->currentFrame], /*VkCommandBufferResetFlagBits*/ 0);
   recordCommandBuffer(commandBuffers[swapChain->currentFrame], imageIndex);
 
+  auto recordingEnd = std::chrono::high_resolution_clock::now();
+  this->recordingTime += std::chrono::duration<double, std::milli>(recordingEnd - recordingStart).count();
+  this->recordedFrames++;
+
   // Queue submission and synchronization.
   VkSubmitInfo submitInfo{};
   submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -735,6 +1210,23 @@ bool Renderer::checkDeviceExtensionSupport(VkPhysicalDevice device)
   return requiredExtensions.empty();
 }
 
+bool Renderer::isDeviceExtensionSupported(VkPhysicalDevice device, const char* extensionName)
+{
+  uint32_t extensionCount;
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+  std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+  for (const auto &extension : availableExtensions) {
+    if (strcmp(extension.extensionName, extensionName) == 0) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
 /**
   * @brief Get extensions which are required by vulkan, like:
   *		  -> VK_KHR_surface
@@ -786,14 +1278,17 @@ bool Renderer::checkValidationLayerSupport()
   return true;
 }
 
-void Renderer::addEntity(Entity& e)
+/**
+ * @brief Gathers every entity that can be drawn, i.e., the ones with a
+ * Transform, a ModelRenderer and a TextureRenderer.
+ */
+void Renderer::collectEntities()
 {
-  // TODO: modelVec.empty() || !(std::count(modelVec.begin(), modelVec.end(), model));
-  bool found = false;
-  ModelRenderer& m = e.getComponent<ModelRenderer>();
-  if (!found) {
-    entitiesVec.insert(entitiesVec.begin(), e);
-  }
+  this->entitiesVec.clear();
+  Engine::get()->entitiesManager.each<Transform, ModelRenderer, TextureRenderer>(
+    [this](Entity &entity, Transform&, ModelRenderer&, TextureRenderer&) {
+      this->entitiesVec.push_back(entity.getHandle());
+    });
 }
 
 #ifdef IMGUI_ENABLED
@@ -844,7 +1339,7 @@ void Renderer::initGui()
   init_info.PhysicalDevice = this->physicalDevice;
   init_info.Device = this->device;
   init_info.Queue = this->graphicsQueue;
-  init_info.PipelineCache = VK_NULL_HANDLE;
+  init_info.PipelineCache = this->pipelineCache->getVkPipelineCache();
   init_info.DescriptorPool = imguiPool;
   init_info.Allocator = VK_NULL_HANDLE;
   init_info.MinImageCount = 2;
@@ -904,6 +1399,26 @@ VkQueue Renderer::getGraphicsQueue()
   return this->graphicsQueue;
 }
 
+GeometryPool* Renderer::getGeometryPool()
+{
+  return this->geometryPool.get();
+}
+
+MemoryAllocator &Renderer::getMemoryAllocator()
+{
+  return *this->memoryAllocator;
+}
+
+UploadBatch &Renderer::getUploadBatch()
+{
+  return *this->uploadBatch;
+}
+
+const FrameContext &Renderer::getFrameContext() const
+{
+  return this->frameContext;
+}
+
 const std::unique_ptr<SwapChain> &Renderer::getSwapChain() const
 {
   return this->swapChain;
@@ -926,5 +1441,11 @@ const std::optional<std::reference_wrapper<Entity>> Renderer::getEntity(int inde
     return {};
   }
 
-  return this->entitiesVec[index];
+  Entity* entity = Engine::get()->entitiesManager.getEntity(this->entitiesVec[index]);
+  if (entity == nullptr) {
+    std::cout << "Warning: Rendering entity in '" << index << "' index has been destroyed.\n";
+    return {};
+  }
+
+  return *entity;
 }
\ No newline at end of file
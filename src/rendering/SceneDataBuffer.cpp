@@ -0,0 +1,95 @@
+#include "SceneDataBuffer.hpp"
+#include "Engine.hpp"
+#include "Utils.hpp"
+
+#include <algorithm>
+
+SceneDataBuffer::SceneDataBuffer(VkDevice device, VkPhysicalDevice physicalDevice, MemoryAllocator &allocator,
+                                 uint32_t capacity, uint32_t instancesCapacity) :
+  capacity(capacity), instancesCapacity(instancesCapacity), cachedDevice(device), cachedAllocator(allocator)
+{
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+  // The objects array is bound at an offset of the same buffer, so it has to respect the alignment.
+  VkDeviceSize alignment = properties.limits.minStorageBufferOffsetAlignment;
+  this->objectsOffset = (sizeof(CameraData) + alignment - 1) & ~(alignment - 1);
+  this->instancesOffset = (this->objectsOffset + this->getObjectsRange() + alignment - 1) & ~(alignment - 1);
+
+  // An empty storage buffer range isn't valid in Vulkan.
+  VkDeviceSize bufferSize = this->instancesOffset + this->getInstancesRange();
+
+  buffers.resize(MAX_FRAMES_IN_FLIGHT);
+  buffersAllocations.resize(MAX_FRAMES_IN_FLIGHT);
+  buffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
+  objectsVersions.assign(MAX_FRAMES_IN_FLIGHT, std::vector<uint32_t>(capacity, 0));
+
+  // One buffer per frame in flight, so the CPU never writes data the GPU is still reading.
+  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    Utils::createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 buffers[i], buffersAllocations[i], device, allocator);
+
+    // Host visible memory is persistently mapped by the allocator.
+    buffersMapped[i] = buffersAllocations[i].mapped;
+  }
+}
+
+SceneDataBuffer::~SceneDataBuffer()
+{
+  for (size_t i = 0; i < buffers.size(); i++) {
+    Utils::destroyBuffer(cachedDevice, buffers[i], buffersAllocations[i], cachedAllocator);
+  }
+}
+
+// Getters and Setters
+
+SceneDataBuffer::CameraData* SceneDataBuffer::getCameraData(uint32_t currentFrame)
+{
+  return static_cast<CameraData*>(this->buffersMapped[currentFrame]);
+}
+
+SceneDataBuffer::ObjectData* SceneDataBuffer::getObjectsData(uint32_t currentFrame)
+{
+  return reinterpret_cast<ObjectData*>(static_cast<char*>(this->buffersMapped[currentFrame]) + this->objectsOffset);
+}
+
+uint32_t* SceneDataBuffer::getInstancesData(uint32_t currentFrame)
+{
+  return reinterpret_cast<uint32_t*>(static_cast<char*>(this->buffersMapped[currentFrame]) + this->instancesOffset);
+}
+
+std::vector<uint32_t> &SceneDataBuffer::getObjectsVersions(uint32_t currentFrame)
+{
+  return this->objectsVersions[currentFrame];
+}
+
+VkBuffer SceneDataBuffer::getBuffer(uint32_t currentFrame)
+{
+  return this->buffers[currentFrame];
+}
+
+VkDeviceSize SceneDataBuffer::getObjectsOffset()
+{
+  return this->objectsOffset;
+}
+
+VkDeviceSize SceneDataBuffer::getObjectsRange()
+{
+  return sizeof(ObjectData) * std::max(this->capacity, 1u);
+}
+
+VkDeviceSize SceneDataBuffer::getInstancesOffset()
+{
+  return this->instancesOffset;
+}
+
+VkDeviceSize SceneDataBuffer::getInstancesRange()
+{
+  return sizeof(uint32_t) * std::max(this->instancesCapacity, 1u);
+}
+
+uint32_t SceneDataBuffer::getCapacity()
+{
+  return this->capacity;
+}
@@ -0,0 +1,165 @@
+#include "StagingBuffer.hpp"
+#include "Utils.hpp"
+
+#include <iostream>
+#include <stdexcept>
+
+StagingBuffer::StagingBuffer(VkDevice device, MemoryAllocator &allocator, VkDeviceSize capacity) :
+  capacity(capacity), cachedDevice(device), cachedAllocator(allocator)
+{
+  Utils::createBuffer(capacity, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                      buffer, bufferAllocation, device, allocator);
+}
+
+StagingBuffer::~StagingBuffer()
+{
+  this->waitIdle();
+
+  // Never submitted, so nothing reads them.
+  for (Overflow &overflow : this->pendingOverflows) {
+    Utils::destroyBuffer(cachedDevice, overflow.buffer, overflow.allocation, cachedAllocator);
+  }
+  for (VkFence fence : this->freeFences) vkDestroyFence(cachedDevice, fence, nullptr);
+  Utils::destroyBuffer(cachedDevice, buffer, bufferAllocation, cachedAllocator);
+}
+
+StagingBuffer::Region StagingBuffer::allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+  this->regionsCount++;
+  this->stagedSize += size;
+  if (size > this->capacity) return this->allocateOverflow(size);
+
+  this->reclaim();
+  // Nothing is in use, so the ring starts over from the beginning of the buffer.
+  if (this->head == this->tail && this->submissions.empty()) this->head = this->tail = 0;
+
+  while (true) {
+    uint64_t start = (this->head + alignment - 1) & ~(alignment - 1);
+    // Regions never wrap around the end of the buffer.
+    VkDeviceSize offset = start % this->capacity;
+    if (offset + size > this->capacity) {
+      start += this->capacity - offset;
+      offset = 0;
+    }
+
+    if (start + size - this->tail <= this->capacity) {
+      this->head = start + size;
+      return { buffer, offset, size, static_cast<char*>(bufferAllocation.mapped) + offset };
+    }
+
+    // Only regions still waiting to be submitted are in the way.
+    if (this->submissions.empty()) return this->allocateOverflow(size);
+
+    this->waitsCount++;
+    vkWaitForFences(cachedDevice, 1, &this->submissions.front().fence, VK_TRUE, UINT64_MAX);
+    this->retire(this->submissions.front());
+    this->submissions.pop_front();
+  }
+}
+
+StagingBuffer::Region StagingBuffer::allocateOverflow(VkDeviceSize size)
+{
+  Overflow overflow{};
+  Utils::createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                      overflow.buffer, overflow.allocation, cachedDevice, cachedAllocator);
+  this->pendingOverflows.push_back(overflow);
+  this->overflowsCount++;
+
+  return { overflow.buffer, 0, size, overflow.allocation.mapped };
+}
+
+VkFence StagingBuffer::getFence()
+{
+  Submission submission{};
+  if (!this->freeFences.empty()) {
+    submission.fence = this->freeFences.back();
+    this->freeFences.pop_back();
+  }
+  else {
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    if (vkCreateFence(cachedDevice, &fenceInfo, nullptr, &submission.fence) != VK_SUCCESS) {
+      throw std::runtime_error("Error: Failed to create a staging buffer fence.\n");
+    }
+  }
+
+  submission.end = this->head;
+  this->submittedCount++;
+  submission.overflows = std::move(this->pendingOverflows);
+  this->pendingOverflows.clear();
+  this->submissions.push_back(std::move(submission));
+
+  return this->submissions.back().fence;
+}
+
+void StagingBuffer::reclaim()
+{
+  while (!this->submissions.empty() &&
+         vkGetFenceStatus(cachedDevice, this->submissions.front().fence) == VK_SUCCESS) {
+    this->retire(this->submissions.front());
+    this->submissions.pop_front();
+  }
+}
+
+bool StagingBuffer::isRetired(uint64_t submission)
+{
+  this->reclaim();
+  return this->retiredCount >= submission;
+}
+
+void StagingBuffer::waitFor(uint64_t submission)
+{
+  while (this->retiredCount < submission && !this->submissions.empty()) {
+    vkWaitForFences(cachedDevice, 1, &this->submissions.front().fence, VK_TRUE, UINT64_MAX);
+    this->retire(this->submissions.front());
+    this->submissions.pop_front();
+  }
+}
+
+void StagingBuffer::waitIdle()
+{
+  for (Submission &submission : this->submissions) {
+    vkWaitForFences(cachedDevice, 1, &submission.fence, VK_TRUE, UINT64_MAX);
+    this->retire(submission);
+  }
+  this->submissions.clear();
+}
+
+// Gives the submission's regions back. Its fence must have signaled.
+void StagingBuffer::retire(Submission &submission)
+{
+  this->tail = submission.end;
+  this->retiredCount++;
+  for (Overflow &overflow : submission.overflows) {
+    Utils::destroyBuffer(cachedDevice, overflow.buffer, overflow.allocation, cachedAllocator);
+  }
+
+  vkResetFences(cachedDevice, 1, &submission.fence);
+  this->freeFences.push_back(submission.fence);
+}
+
+// Getters and Setters
+
+uint64_t StagingBuffer::getSubmittedCount() const
+{
+  return this->submittedCount;
+}
+
+VkDeviceSize StagingBuffer::getPendingSize() const
+{
+  return this->head - (this->submissions.empty() ? this->tail : this->submissions.back().end);
+}
+
+VkDeviceSize StagingBuffer::getCapacity() const
+{
+  return this->capacity;
+}
+
+void StagingBuffer::printStats()
+{
+  std::cout << "INFO: Staging ring of " << this->capacity / (1024 * 1024) << " MiB: " << this->regionsCount
+            << " region(s), " << this->stagedSize / (1024 * 1024) << " MiB staged, " << this->waitsCount
+            << " wait(s) for older uploads, " << this->overflowsCount << " overflow buffer(s).\n";
+}
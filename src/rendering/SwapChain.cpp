@@ -1,4 +1,5 @@
 #include <limits>
+#include <array>
 
 #include "SwapChain.hpp"
 #include "QueueFamilyIndices.hpp"
@@ -6,7 +7,8 @@
 #include "Engine.hpp"
 #include "Utils.hpp"
 
-SwapChain::SwapChain(VkPhysicalDevice physicalDevice, VkDevice device, VkSurfaceKHR surface, VkSampleCountFlagBits numMsaaSamples) : cachedDevice(device), cachedMsaaSample(numMsaaSamples)
+SwapChain::SwapChain(VkPhysicalDevice physicalDevice, VkDevice device, VkSurfaceKHR surface, VkSampleCountFlagBits numMsaaSamples,
+                     bool depthSampled) : depthSampled(depthSampled), cachedDevice(device), cachedMsaaSample(numMsaaSamples)
 {
   this->createSwapChain(physicalDevice, device, surface);
   this->createImageViews(device);
@@ -114,16 +116,16 @@ void SwapChain::clean(VkDevice device, VkSampleCountFlagBits msaaSample)
 
 void SwapChain::restartSwapChain(VkDevice device, VkSampleCountFlagBits msaaSample)
 {
+  MemoryAllocator &allocator = Engine::get()->getRenderer()->getMemoryAllocator();
+
   // Destroys color images if it has been created due to MSAA activation.
   if (msaaSample != VK_SAMPLE_COUNT_1_BIT) {
     vkDestroyImageView(device, colorImageView, nullptr);
-    vkDestroyImage(device, colorImage, nullptr);
-    vkFreeMemory(device, colorImageMemory, nullptr);
+    Utils::destroyImage(device, colorImage, colorImageAllocation, allocator);
   }
 
   vkDestroyImageView(device, depthImageView, nullptr);
-  vkDestroyImage(device, depthImage, nullptr);
-  vkFreeMemory(device, depthImageMemory, nullptr);
+  Utils::destroyImage(device, depthImage, depthImageAllocation, allocator);
 
   for (size_t i = 0; i < swapChainFramebuffers.size(); i++) {
     vkDestroyFramebuffer(device, swapChainFramebuffers[i], nullptr);
@@ -207,11 +209,18 @@ void SwapChain::createRenderPass(VkDevice device, VkPhysicalDevice physicalDevic
   depthAttachment.format         = findDepthFormat(physicalDevice);
   depthAttachment.samples        = msaaSamples;
   depthAttachment.loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR;
-  depthAttachment.storeOp        = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   depthAttachment.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
   depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   depthAttachment.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
-  depthAttachment.finalLayout    = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  // Only kept to build the depth pyramid. Otherwise, it never has to leave the tile memory.
+  if (this->depthSampled) {
+    depthAttachment.storeOp     = VK_ATTACHMENT_STORE_OP_STORE;
+    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+  }
+  else {
+    depthAttachment.storeOp     = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  }
 
   VkAttachmentDescription colorAttachmentResolve{};
   colorAttachmentResolve.format = swapChainImageFormat;
@@ -244,7 +253,9 @@ void SwapChain::createRenderPass(VkDevice device, VkPhysicalDevice physicalDevic
     subpass.pResolveAttachments = &colorAttachmentResolveRef;
   } 
 
-  VkSubpassDependency dependency{};
+  std::vector<VkSubpassDependency> dependencies(this->depthSampled ? 2 : 1);
+
+  VkSubpassDependency &dependency = dependencies[0];
   dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
   dependency.dstSubpass = 0;
 
@@ -254,6 +265,22 @@ void SwapChain::createRenderPass(VkDevice device, VkPhysicalDevice physicalDevic
   dependency.dstStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
   dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
+  if (this->depthSampled) {
+    // The depth buffer is also read by compute shaders between frames, so they must finish before it's cleared again.
+    dependency.srcStageMask |= VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+    // Makes the depth written by the render pass visible to the depth pyramid.
+    VkSubpassDependency &depthDependency = dependencies[1];
+    depthDependency.srcSubpass = 0;
+    depthDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+
+    depthDependency.srcStageMask  = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    depthDependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    depthDependency.dstStageMask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    depthDependency.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  }
+
   std::vector<VkAttachmentDescription> attachments;
   if (msaaSamples == VK_SAMPLE_COUNT_1_BIT)
     attachments = {colorAttachment, depthAttachment};
@@ -266,8 +293,8 @@ void SwapChain::createRenderPass(VkDevice device, VkPhysicalDevice physicalDevic
   renderPassInfo.pAttachments    = attachments.data();
   renderPassInfo.subpassCount    = 1;
   renderPassInfo.pSubpasses      = &subpass;
-  renderPassInfo.dependencyCount = 1;
-  renderPassInfo.pDependencies   = &dependency;
+  renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+  renderPassInfo.pDependencies   = dependencies.data();
 
   if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
     throw std::runtime_error("Error: Failed to create the render pass.\n");
@@ -386,10 +413,10 @@ void SwapChain::createColorResources(VkDevice device, VkPhysicalDevice physicalD
   if (Engine::get()->getRenderer()->msaaSetting != Renderer::MsaaSetting::DISABLED) {
     VkFormat colorFormat = swapChainImageFormat;
 
-    Utils::createImage(device, physicalDevice, swapChainExtent.width, swapChainExtent.height, 
+    Utils::createImage(device, Engine::get()->getRenderer()->getMemoryAllocator(), swapChainExtent.width, swapChainExtent.height, 
                       1, msaaSamples, colorFormat, VK_IMAGE_TILING_OPTIMAL, 
                       VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, 
-                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, colorImage, colorImageMemory);
+                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, colorImage, colorImageAllocation);
     colorImageView = Utils::createImageView(device, colorImage, colorFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1);
   }
 }
@@ -401,7 +428,10 @@ void SwapChain::createDepthResources(VkDevice device, VkPhysicalDevice physicalD
 {
   VkFormat depthFormat = findDepthFormat(physicalDevice);
   
-  Utils::createImage(device, physicalDevice, swapChainExtent.width, swapChainExtent.height, 1, numMsaaSamples, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageMemory);
+  // Sampled by the depth pyramid after each frame, if there is one.
+  VkImageUsageFlags usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+  if (this->depthSampled) usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+  Utils::createImage(device, Engine::get()->getRenderer()->getMemoryAllocator(), swapChainExtent.width, swapChainExtent.height, 1, numMsaaSamples, depthFormat, VK_IMAGE_TILING_OPTIMAL, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageAllocation);
   this->depthImageView = Utils::createImageView(device, depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
 
   Utils::transitionImageLayout(device, graphicsQueue, commandPool, 
@@ -430,12 +460,16 @@ VkFormat SwapChain::findSupportedFormat(VkPhysicalDevice physicalDevice, const s
 }
 
 // Helper function to select a format with a depth component that supports usage as depth attachment.
+// It must also be sampleable when the depth pyramid reads it.
 VkFormat SwapChain::findDepthFormat(VkPhysicalDevice physicalDevice)
 {
+  VkFormatFeatureFlags features = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT;
+  if (this->depthSampled) features |= VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+
   return findSupportedFormat(physicalDevice,
       {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
       VK_IMAGE_TILING_OPTIMAL,
-      VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
+      features
   );
 }
 
@@ -486,6 +520,16 @@ std::vector<VkFence> SwapChain::getImagesInFlight()
   return this->imagesInFlight;
 }
 
+VkImageView SwapChain::getDepthImageView()
+{
+  return this->depthImageView;
+}
+
+bool SwapChain::isDepthSampled()
+{
+  return this->depthSampled;
+}
+
 int SwapChain::getSwapChainImageViewsSize()
 {
   return this->swapChainImageViews.size();
@@ -0,0 +1,133 @@
+#include "UploadBatch.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+UploadBatch::UploadBatch(VkDevice device, VkQueue graphicsQueue, VkCommandPool commandPool,
+                         StagingBuffer &stagingBuffer) :
+  cachedDevice(device), cachedGraphicsQueue(graphicsQueue), cachedCommandPool(commandPool),
+  cachedStagingBuffer(stagingBuffer)
+{
+
+}
+
+UploadBatch::~UploadBatch()
+{
+  this->wait();
+}
+
+StagingBuffer::Region UploadBatch::stage(VkDeviceSize size)
+{
+  // The ring can't reuse anything this batch staged until it is submitted.
+  if (this->commandBuffer != VK_NULL_HANDLE &&
+      cachedStagingBuffer.getPendingSize() + size > cachedStagingBuffer.getCapacity()) {
+    this->submit();
+  }
+
+  this->uploadsCount++;
+  return cachedStagingBuffer.allocate(size);
+}
+
+VkCommandBuffer UploadBatch::getCommandBuffer()
+{
+  if (this->commandBuffer != VK_NULL_HANDLE) return this->commandBuffer;
+
+  VkCommandBufferAllocateInfo allocInfo{};
+  allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocInfo.commandPool        = cachedCommandPool;
+  allocInfo.commandBufferCount = 1;
+
+  if (vkAllocateCommandBuffers(cachedDevice, &allocInfo, &this->commandBuffer) != VK_SUCCESS) {
+    throw std::runtime_error("Error: Failed to allocate an upload command buffer.\n");
+  }
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  vkBeginCommandBuffer(this->commandBuffer, &beginInfo);
+
+  return this->commandBuffer;
+}
+
+void UploadBatch::transferBarrier()
+{
+  VkMemoryBarrier barrier{};
+  barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+  vkCmdPipelineBarrier(this->getCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                       1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void UploadBatch::submit()
+{
+  if (this->commandBuffer == VK_NULL_HANDLE) return;
+
+  // Barriers also order the commands of later submissions to the same queue, e.g. the next frames' draws.
+  VkMemoryBarrier barrier{};
+  barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT |
+                          VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+  vkCmdPipelineBarrier(this->commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                       VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                       1, &barrier, 0, nullptr, 0, nullptr);
+  vkEndCommandBuffer(this->commandBuffer);
+
+  VkSubmitInfo submitInfo{};
+  submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers    = &this->commandBuffer;
+
+  VkFence fence = cachedStagingBuffer.getFence();
+  if (vkQueueSubmit(cachedGraphicsQueue, 1, &submitInfo, fence) != VK_SUCCESS) {
+    throw std::runtime_error("Error: Failed to submit the upload command buffer.\n");
+  }
+
+  this->lastSubmission = cachedStagingBuffer.getSubmittedCount();
+  this->submitted.push_back({ this->lastSubmission, this->commandBuffer });
+  this->commandBuffer = VK_NULL_HANDLE;
+  this->submitsCount++;
+
+  this->freeCommandBuffers();
+}
+
+bool UploadBatch::isDone()
+{
+  if (this->commandBuffer != VK_NULL_HANDLE) return false;
+
+  bool done = cachedStagingBuffer.isRetired(this->lastSubmission);
+  this->freeCommandBuffers();
+  return done;
+}
+
+void UploadBatch::wait()
+{
+  this->submit();
+  cachedStagingBuffer.waitFor(this->lastSubmission);
+  this->freeCommandBuffers();
+}
+
+// Frees the command buffers whose submissions are done.
+void UploadBatch::freeCommandBuffers()
+{
+  auto doneEnd = std::partition(this->submitted.begin(), this->submitted.end(), [this](const Submitted &submitted) {
+    return !cachedStagingBuffer.isRetired(submitted.submission);
+  });
+
+  for (auto submittedObj = doneEnd; submittedObj != this->submitted.end(); submittedObj++) {
+    vkFreeCommandBuffers(cachedDevice, cachedCommandPool, 1, &submittedObj->commandBuffer);
+  }
+  this->submitted.erase(doneEnd, this->submitted.end());
+}
+
+void UploadBatch::printStats()
+{
+  std::cout << "INFO: Upload batch: " << this->uploadsCount << " upload(s) in " << this->submitsCount
+            << " submission(s).\n";
+}
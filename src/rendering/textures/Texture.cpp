@@ -21,12 +21,10 @@ void Texture::clean(VkDevice device)
   vkDestroySampler(device, textureSampler, nullptr);
   vkDestroyImageView(device, textureImageView, nullptr);
 
-  vkDestroyImage(device, textureImage, nullptr);
-  vkFreeMemory(device, textureImageMemory, nullptr);
+  Utils::destroyImage(device, textureImage, textureImageAllocation, Engine::get()->getRenderer()->getMemoryAllocator());
 }
 
-void Texture::createTextureImage(VkDevice device, VkPhysicalDevice physicalDevice, 
-                                 VkQueue graphicsQueue, VkCommandPool commandPool)
+void Texture::createTextureImage(VkDevice device, VkPhysicalDevice physicalDevice, UploadBatch &uploadBatch)
 {
   int texWidth, texHeight, texChannels;
   stbi_uc* pixels = stbi_load(filepath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
@@ -42,48 +40,36 @@ void Texture::createTextureImage(VkDevice device, VkPhysicalDevice physicalDevic
     throw std::runtime_error("Error: Failed to load texture image: '" + this->filepath + "'.\n");
   }
 
-  // Create a buffer in host visible memory so that we can use vkMapMemory and copy the pixels to it.
-  VkBuffer stagingBuffer;
-  VkDeviceMemory stagingBufferMemory;
+  MemoryAllocator &allocator = Engine::get()->getRenderer()->getMemoryAllocator();
 
-  Utils::createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
-               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
-               stagingBuffer, stagingBufferMemory, device, physicalDevice);
-
-  // Copy the pixel values that we got from the image loading library to the buffer.
-  void* data;
-  vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
-      memcpy(data, pixels, static_cast<size_t>(imageSize));
-  vkUnmapMemory(device, stagingBufferMemory);
+  // Copy the pixel values that we got from the image loading library to a region of the staging ring.
+  StagingBuffer::Region stagingRegion = uploadBatch.stage(imageSize);
+  memcpy(stagingRegion.mapped, pixels, static_cast<size_t>(imageSize));
 
   // Clean up the original pixel array.
   stbi_image_free(pixels);
 
-  Utils::createImage(device, physicalDevice, texWidth, texHeight, mipLevels, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8G8B8A8_SRGB, 
+  Utils::createImage(device, allocator, texWidth, texHeight, mipLevels, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8G8B8A8_SRGB, 
               VK_IMAGE_TILING_OPTIMAL, 
               VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, 
-              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
-
-  // Prepare the texture image.
-  Utils::transitionImageLayout(device, graphicsQueue, commandPool, 
-                        textureImage, VK_FORMAT_R8G8B8A8_SRGB, 
-                        VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
-  copyBufferToImage(device, graphicsQueue, commandPool, 
-                    stagingBuffer, textureImage, 
+              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageAllocation);
+
+  // Prepare the texture image. Every command goes to the batch, next to the other assets' uploads.
+  VkCommandBuffer commandBuffer = uploadBatch.getCommandBuffer();
+  Utils::recordImageLayoutTransition(commandBuffer, textureImage, VK_FORMAT_R8G8B8A8_SRGB, 
+                                     VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
+  copyBufferToImage(commandBuffer, stagingRegion.buffer, stagingRegion.offset, textureImage, 
                     static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
 
   // Transitioned to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL while generating mipmaps.
   if (Engine::get()->getRenderer()->mipmapSetting == Renderer::MipmapSetting::DISABLED) {
-    Utils::transitionImageLayout(device, graphicsQueue, commandPool, textureImage, 
-                          VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 
-                          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipLevels);
+    Utils::recordImageLayoutTransition(commandBuffer, textureImage, VK_FORMAT_R8G8B8A8_SRGB,
+                                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 
+                                       VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipLevels);
   }
 
-  vkDestroyBuffer(device, stagingBuffer, nullptr);
-  vkFreeMemory(device, stagingBufferMemory, nullptr);
-
   if (Engine::get()->getRenderer()->mipmapSetting == Renderer::MipmapSetting::LINEAR) {
-    generateMipmaps(device, physicalDevice, graphicsQueue, commandPool,
+    generateMipmaps(physicalDevice, commandBuffer,
                     textureImage, VK_FORMAT_R8G8B8A8_SRGB, texWidth, texHeight, mipLevels);
   }
 }
@@ -149,16 +135,13 @@ void Texture::createTextureSampler(VkDevice device, VkPhysicalDevice physicalDev
   }
 }
 
-void Texture::copyBufferToImage(VkDevice device, VkQueue graphicsQueue, 
-                                VkCommandPool commandPool,
-                                VkBuffer buffer, VkImage image, 
+void Texture::copyBufferToImage(VkCommandBuffer commandBuffer,
+                                VkBuffer buffer, VkDeviceSize bufferOffset, VkImage image, 
                                 uint32_t width, uint32_t height)
 {
-  VkCommandBuffer commandBuffer = Utils::beginSingleTimeCommands(device, commandPool);
-
   // Specifies which part of the buffer is going to be copied to which part of the image.
   VkBufferImageCopy region{};
-  region.bufferOffset = 0;
+  region.bufferOffset = bufferOffset;
   region.bufferRowLength = 0;
   region.bufferImageHeight = 0;
 
@@ -182,11 +165,9 @@ void Texture::copyBufferToImage(VkDevice device, VkQueue graphicsQueue,
     1,
     &region
   );
-
-  Utils::endSingleTimeCommands(device, graphicsQueue, commandPool, commandBuffer);
 }
 
-void Texture::generateMipmaps(VkDevice device, VkPhysicalDevice physicalDevice, VkQueue graphicsQueue, VkCommandPool commandPool,
+void Texture::generateMipmaps(VkPhysicalDevice physicalDevice, VkCommandBuffer commandBuffer,
                               VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels)
 {
   // Check if image format supports linear blitting
@@ -197,8 +178,6 @@ void Texture::generateMipmaps(VkDevice device, VkPhysicalDevice physicalDevice,
     throw std::runtime_error("Error: Texture image format does not support linear blitting.\n");
   }
 
-  VkCommandBuffer commandBuffer = Utils::beginSingleTimeCommands(device, commandPool);
-
   VkImageMemoryBarrier barrier{};
   barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
   barrier.image = image;
@@ -278,8 +257,6 @@ void Texture::generateMipmaps(VkDevice device, VkPhysicalDevice physicalDevice,
     0, nullptr,
     1, &barrier
   );
-
-  Utils::endSingleTimeCommands(device, graphicsQueue, commandPool, commandBuffer);
 }
 
 // Getters and Setters
@@ -1,6 +1,9 @@
 #include "AssetPool.hpp"
+#include "MeshSimplifier.hpp"
+#include "MeshOptimizer.hpp"
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "tiny_obj_loader.h"
@@ -27,11 +30,11 @@ void AssetPool::addShader(VkDevice device, const std::string resourceID, const s
 	// Resource's ID wasn't the same. Checking for file names but only in debugging mode.
 #ifndef NDEBUG
 	for (auto mapObject : shadersMap) {
-		if (mapObject.second->getFragmentShaderFilepath().compare(fragmentShaderPath) == 0) {
-			std::cout << "Warning: You shouldn't have reloaded the shader '" << fragmentShaderPath << "' has been already added.\n";
-		}
-		if (mapObject.second->getVertexShaderFilepath().compare(vertexShaderPath) == 0) {
-			std::cout << "Warning: You shouldn't have reloaded the shader '" << vertexShaderPath << "' has been already added.\n";
+		// Shaders may share one of their stages, e.g. "texture" and "texture_packed" share the fragment shader.
+		if (mapObject.second->getFragmentShaderFilepath().compare(fragmentShaderPath) == 0 &&
+				mapObject.second->getVertexShaderFilepath().compare(vertexShaderPath) == 0) {
+			std::cout << "Warning: You shouldn't have reloaded the shaders '" << fragmentShaderPath << "' and '"
+								<< vertexShaderPath << "', they have been already added.\n";
 		}
 	}
 #endif
@@ -181,10 +184,117 @@ void AssetPool::insertModel(const std::string resourceID, const std::string MODE
     }
   }
 
-	std::shared_ptr<Model> model = std::make_shared<Model>(MODEL_PATH, vertices, indices);
+	Model::Bounds bounds = AssetPool::computeBounds(vertices);
+	std::vector<Model::Lod> lods = AssetPool::generateLods(MODEL_PATH, vertices, indices, bounds);
+	AssetPool::optimizeMesh(MODEL_PATH, vertices, indices, lods);
+
+	Model::VertexFormat vertexFormat = AssetPool::chooseVertexFormat(MODEL_PATH, vertices);
+
+	std::shared_ptr<Model> model = std::make_shared<Model>(MODEL_PATH, vertices, indices, lods, bounds, vertexFormat);
 	AssetPool::modelsMap.insert({ resourceID, model });
 }
 
+/**
+ * @brief Gets the axis-aligned bounding box of the vertices and a bounding
+ * sphere centered on the box, which is tight enough for culling and cheap.
+ */
+Model::Bounds AssetPool::computeBounds(const std::vector<Model::Vertex> &vertices)
+{
+	Model::Bounds bounds{};
+	if (vertices.empty()) return bounds;
+
+	bounds.min = vertices[0].pos;
+	bounds.max = vertices[0].pos;
+	for (const Model::Vertex &vertex : vertices) {
+		bounds.min = glm::min(bounds.min, vertex.pos);
+		bounds.max = glm::max(bounds.max, vertex.pos);
+	}
+
+	bounds.sphereCenter = (bounds.min + bounds.max) * 0.5f;
+	for (const Model::Vertex &vertex : vertices) {
+		bounds.sphereRadius = std::max(bounds.sphereRadius, glm::length(vertex.pos - bounds.sphereCenter));
+	}
+
+	return bounds;
+}
+
+/**
+ * @brief Simplifies the mesh into its coarser levels of detail and appends
+ * their indices after the mesh's own, so every level lives in the same buffers.
+ */
+std::vector<Model::Lod> AssetPool::generateLods(const std::string &modelPath, const std::vector<Model::Vertex> &vertices,
+                                                std::vector<uint32_t> &indices, const Model::Bounds &bounds)
+{
+	std::vector<Model::Lod> lods;
+	lods.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.0f });
+
+	std::vector<MeshSimplifier::Level> levels = MeshSimplifier::simplify(vertices, indices, Model::MAX_LODS - 1);
+	for (const MeshSimplifier::Level &level : levels) {
+		float error = bounds.sphereRadius > 0.0f ? level.error / bounds.sphereRadius : 0.0f;
+		lods.push_back({ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(level.indices.size()), error });
+		indices.insert(indices.end(), level.indices.begin(), level.indices.end());
+	}
+
+	std::cout << "INFO: Model '" << modelPath << "' has " << lods.size() << " level(s) of detail with";
+	for (const Model::Lod &lod : lods) std::cout << " " << lod.indicesCount / 3;
+	std::cout << " triangles.\n";
+
+	return lods;
+}
+
+/**
+ * @brief Reorders the triangles of every level of detail for the vertex cache,
+ * and for overdraw when it is enabled, then lays the vertices out in the order
+ * they are used. The full mesh's ACMR and ATVR are printed before and after.
+ */
+void AssetPool::optimizeMesh(const std::string &modelPath, std::vector<Model::Vertex> &vertices,
+                             std::vector<uint32_t> &indices, const std::vector<Model::Lod> &lods)
+{
+	std::vector<uint32_t> lodIndices(indices.begin(), indices.begin() + lods[0].indicesCount);
+	MeshOptimizer::CacheStats before = MeshOptimizer::analyzeVertexCache(lodIndices, vertices.size());
+
+	for (const Model::Lod &lod : lods) {
+		lodIndices.assign(indices.begin() + lod.firstIndex, indices.begin() + lod.firstIndex + lod.indicesCount);
+		MeshOptimizer::optimizeVertexCache(lodIndices, vertices.size());
+		if (AssetPool::overdrawOptimization) {
+			MeshOptimizer::optimizeOverdraw(lodIndices, vertices, AssetPool::OVERDRAW_THRESHOLD);
+		}
+		std::copy(lodIndices.begin(), lodIndices.end(), indices.begin() + lod.firstIndex);
+	}
+	MeshOptimizer::optimizeVertexFetch(vertices, indices);
+
+	lodIndices.assign(indices.begin(), indices.begin() + lods[0].indicesCount);
+	MeshOptimizer::CacheStats after = MeshOptimizer::analyzeVertexCache(lodIndices, vertices.size());
+
+	std::cout << "INFO: Model '" << modelPath << "' vertex cache ACMR " << before.acmr << " -> " << after.acmr
+	          << ", ATVR " << before.atvr << " -> " << after.atvr << ".\n";
+}
+
+/**
+ * @brief Packs the mesh when it is enabled and the mesh has a single color,
+ * which then becomes a per mesh constant. Prints the vertex buffer's size.
+ */
+Model::VertexFormat AssetPool::chooseVertexFormat(const std::string &modelPath, const std::vector<Model::Vertex> &vertices)
+{
+	size_t fullSize = vertices.size() * sizeof(Model::Vertex);
+
+	if (!AssetPool::vertexPacking) return Model::VertexFormat::FULL;
+
+	for (const Model::Vertex &vertex : vertices) {
+		if (vertex.color != vertices[0].color) {
+			std::cout << "INFO: Model '" << modelPath << "' keeps full vertices (" << fullSize / 1024
+			          << " KiB) because its color isn't constant.\n";
+			return Model::VertexFormat::FULL;
+		}
+	}
+
+	size_t packedSize = vertices.size() * sizeof(Model::PackedVertex);
+	std::cout << "INFO: Model '" << modelPath << "' uses packed vertices: " << sizeof(Model::PackedVertex)
+	          << " instead of " << sizeof(Model::Vertex) << " bytes per vertex (" << packedSize / 1024
+	          << " KiB instead of " << fullSize / 1024 << " KiB).\n";
+	return Model::VertexFormat::PACKED;
+}
+
 void AssetPool::addModel(const std::string resourceID, const std::string modelPath)
 {
 	// Add to hash map if it is empty --because if it is empty it is certain
@@ -217,10 +327,10 @@ std::shared_ptr<Model> AssetPool::getModel(const std::string resourceID)
 	return mapObj->second;
 }
 
-void AssetPool::loadTextures(VkDevice device, VkPhysicalDevice physicalDevice, VkQueue graphicsQueue, VkCommandPool commandPool)
+void AssetPool::loadTextures(VkDevice device, VkPhysicalDevice physicalDevice, UploadBatch &uploadBatch)
 {
 	for (auto mapObj : texturesMap) {
-		mapObj.second->createTextureImage(device, physicalDevice, graphicsQueue, commandPool);
+		mapObj.second->createTextureImage(device, physicalDevice, uploadBatch);
   	mapObj.second->createTextureImageView(device);
   	mapObj.second->createTextureSampler(device, physicalDevice);
 	}
@@ -228,8 +338,27 @@ void AssetPool::loadTextures(VkDevice device, VkPhysicalDevice physicalDevice, V
 
 void AssetPool::loadModels()
 {
+	VkDeviceSize indicesSize = 0;
+	VkDeviceSize fullIndicesSize = 0;
+
 	for (auto mpObj : modelsMap) {
 		mpObj.second->init();
+
+		const std::shared_ptr<Model> &model = mpObj.second;
+		VkDeviceSize fullSize = model->getIndexBufferSize();
+		if (model->getIndexType() == VK_INDEX_TYPE_UINT16) {
+			fullSize *= 2;
+			std::cout << "INFO: Model '" << model->FILEPATH << "' uses 16-bit indices (" << model->getIndexBufferSize() / 1024
+			          << " KiB instead of " << fullSize / 1024 << " KiB).\n";
+		}
+
+		indicesSize += model->getIndexBufferSize();
+		fullIndicesSize += fullSize;
+	}
+
+	if (!modelsMap.empty()) {
+		std::cout << "INFO: Index buffers take " << indicesSize / 1024 << " KiB, " << (fullIndicesSize - indicesSize) / 1024
+		          << " KiB saved by 16-bit indices.\n";
 	}
 }
 
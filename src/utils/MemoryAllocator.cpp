@@ -0,0 +1,377 @@
+#include "MemoryAllocator.hpp"
+#include "Utils.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+  uint32_t findMsb(VkDeviceSize value)
+  {
+    uint32_t msb = 0;
+    while (value >>= 1) msb++;
+    return msb;
+  }
+
+  uint32_t findLsb(uint32_t value)
+  {
+    uint32_t lsb = 0;
+    while ((value & 1u) == 0) {
+      value >>= 1;
+      lsb++;
+    }
+    return lsb;
+  }
+
+  VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+  {
+    return (value + alignment - 1) / alignment * alignment;
+  }
+}
+
+MemoryAllocator::Block::Block(VkDeviceSize size) : size(size)
+{
+  for (uint32_t fl = 0; fl < FL_COUNT; fl++) {
+    for (uint32_t sl = 0; sl < SL_COUNT; sl++) this->freeLists[fl][sl] = NONE;
+  }
+
+  this->insertFree(this->createNode(0, size));
+}
+
+/**
+ * @brief Finds the lists of a size. The first level is the size's power of
+ * two and the second one splits it in SL_COUNT equal ranges.
+ */
+void MemoryAllocator::Block::mapping(VkDeviceSize size, uint32_t &fl, uint32_t &sl)
+{
+  if (size < (VkDeviceSize(1) << SMALL_SIZE_LOG2)) {
+    fl = 0;
+    sl = static_cast<uint32_t>(size >> (SMALL_SIZE_LOG2 - SL_COUNT_LOG2));
+    return;
+  }
+
+  uint32_t msb = findMsb(size);
+  fl = msb - SMALL_SIZE_LOG2 + 1;
+  sl = static_cast<uint32_t>(size >> (msb - SL_COUNT_LOG2)) & (SL_COUNT - 1);
+}
+
+uint32_t MemoryAllocator::Block::createNode(VkDeviceSize offset, VkDeviceSize size)
+{
+  Node node{};
+  node.offset = offset;
+  node.size   = size;
+
+  if (!this->unusedNodes.empty()) {
+    uint32_t index = this->unusedNodes.back();
+    this->unusedNodes.pop_back();
+    this->nodes[index] = node;
+    return index;
+  }
+
+  this->nodes.push_back(node);
+  return static_cast<uint32_t>(this->nodes.size() - 1);
+}
+
+void MemoryAllocator::Block::insertFree(uint32_t index)
+{
+  Node &node = this->nodes[index];
+  uint32_t fl, sl;
+  mapping(node.size, fl, sl);
+
+  node.free         = true;
+  node.previousFree = NONE;
+  node.nextFree     = this->freeLists[fl][sl];
+  if (node.nextFree != NONE) this->nodes[node.nextFree].previousFree = index;
+
+  this->freeLists[fl][sl] = index;
+  this->flBitmap |= 1u << fl;
+  this->slBitmaps[fl] |= 1u << sl;
+}
+
+void MemoryAllocator::Block::removeFree(uint32_t index)
+{
+  Node &node = this->nodes[index];
+  uint32_t fl, sl;
+  mapping(node.size, fl, sl);
+
+  if (node.previousFree != NONE) this->nodes[node.previousFree].nextFree = node.nextFree;
+  else this->freeLists[fl][sl] = node.nextFree;
+  if (node.nextFree != NONE) this->nodes[node.nextFree].previousFree = node.previousFree;
+
+  if (this->freeLists[fl][sl] == NONE) {
+    this->slBitmaps[fl] &= ~(1u << sl);
+    if (this->slBitmaps[fl] == 0) this->flBitmap &= ~(1u << fl);
+  }
+  node.free = false;
+}
+
+bool MemoryAllocator::Block::allocate(VkDeviceSize size, VkDeviceSize alignment, uint32_t &index)
+{
+  // Every node of the list found is big enough for the size and the worst alignment padding,
+  // since the size is rounded up to the next list first.
+  VkDeviceSize searchSize = size + alignment - 1;
+  uint32_t roundingLog2 = searchSize >= (VkDeviceSize(1) << SMALL_SIZE_LOG2) ? findMsb(searchSize) - SL_COUNT_LOG2
+                                                                             : SMALL_SIZE_LOG2 - SL_COUNT_LOG2;
+  searchSize += (VkDeviceSize(1) << roundingLog2) - 1;
+  if (searchSize > this->size) return false;
+
+  uint32_t fl, sl;
+  mapping(searchSize, fl, sl);
+  if (fl >= FL_COUNT) return false;
+
+  uint32_t slMap = this->slBitmaps[fl] & (~0u << sl);
+  if (slMap == 0) {
+    uint32_t flMap = fl + 1 < FL_COUNT ? this->flBitmap & (~0u << (fl + 1)) : 0;
+    if (flMap == 0) return false;
+
+    fl = findLsb(flMap);
+    slMap = this->slBitmaps[fl];
+  }
+  sl = findLsb(slMap);
+
+  index = this->freeLists[fl][sl];
+  this->removeFree(index);
+
+  // The padding before the aligned offset and what's left after the range go back to the free lists.
+  VkDeviceSize offset  = this->nodes[index].offset;
+  VkDeviceSize padding = alignUp(offset, alignment) - offset;
+  if (padding > 0) {
+    uint32_t paddingIndex = this->createNode(offset, padding);
+    Node &paddingNode = this->nodes[paddingIndex];
+    Node &node = this->nodes[index];
+    paddingNode.previousPhysical = node.previousPhysical;
+    paddingNode.nextPhysical     = index;
+    if (node.previousPhysical != NONE) this->nodes[node.previousPhysical].nextPhysical = paddingIndex;
+    node.previousPhysical = paddingIndex;
+    node.offset += padding;
+    node.size   -= padding;
+    this->insertFree(paddingIndex);
+  }
+
+  VkDeviceSize remainingSize = this->nodes[index].size - size;
+  if (remainingSize > 0) {
+    uint32_t remainingIndex = this->createNode(this->nodes[index].offset + size, remainingSize);
+    Node &remainingNode = this->nodes[remainingIndex];
+    Node &node = this->nodes[index];
+    remainingNode.previousPhysical = index;
+    remainingNode.nextPhysical     = node.nextPhysical;
+    if (node.nextPhysical != NONE) this->nodes[node.nextPhysical].previousPhysical = remainingIndex;
+    node.nextPhysical = remainingIndex;
+    node.size = size;
+    this->insertFree(remainingIndex);
+  }
+
+  this->allocationsCount++;
+  this->usedSize += size;
+  return true;
+}
+
+// Merges the range with its free neighbours before giving it back.
+void MemoryAllocator::Block::free(uint32_t index)
+{
+  this->allocationsCount--;
+  this->usedSize -= this->nodes[index].size;
+
+  uint32_t nextIndex = this->nodes[index].nextPhysical;
+  if (nextIndex != NONE && this->nodes[nextIndex].free) {
+    this->removeFree(nextIndex);
+    Node &node = this->nodes[index];
+    node.size += this->nodes[nextIndex].size;
+    node.nextPhysical = this->nodes[nextIndex].nextPhysical;
+    if (node.nextPhysical != NONE) this->nodes[node.nextPhysical].previousPhysical = index;
+    this->unusedNodes.push_back(nextIndex);
+  }
+
+  uint32_t previousIndex = this->nodes[index].previousPhysical;
+  if (previousIndex != NONE && this->nodes[previousIndex].free) {
+    this->removeFree(previousIndex);
+    Node &previousNode = this->nodes[previousIndex];
+    previousNode.size += this->nodes[index].size;
+    previousNode.nextPhysical = this->nodes[index].nextPhysical;
+    if (previousNode.nextPhysical != NONE) this->nodes[previousNode.nextPhysical].previousPhysical = previousIndex;
+    this->unusedNodes.push_back(index);
+    index = previousIndex;
+  }
+
+  this->insertFree(index);
+}
+
+MemoryAllocator::MemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice) :
+  cachedDevice(device), cachedPhysicalDevice(physicalDevice)
+{
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &this->memoryProperties);
+
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+  this->bufferImageGranularity = properties.limits.bufferImageGranularity;
+  this->maxAllocationsCount    = properties.limits.maxMemoryAllocationCount;
+
+  this->dedicatedCounts.assign(this->memoryProperties.memoryTypeCount, 0);
+  this->dedicatedSizes.assign(this->memoryProperties.memoryTypeCount, 0);
+}
+
+MemoryAllocator::~MemoryAllocator()
+{
+  for (const std::unique_ptr<Block> &block : this->blocks) {
+    this->freeMemory(block->memory, block->mapped != nullptr);
+  }
+}
+
+MemoryAllocator::Allocation MemoryAllocator::allocate(const VkMemoryRequirements &requirements,
+                                                      VkMemoryPropertyFlags properties, Resource resource)
+{
+  Allocation allocation{};
+  allocation.memoryType = Utils::findMemoryType(requirements.memoryTypeBits, properties, cachedPhysicalDevice);
+  allocation.size       = requirements.size;
+
+  VkDeviceSize blockSize = this->getBlockSize(allocation.memoryType);
+  bool dedicated = requirements.size > blockSize / 2 ||
+                   (resource == Resource::OPTIMAL_IMAGE && requirements.size >= DEDICATED_IMAGE_SIZE);
+  if (dedicated) {
+    allocation.memory = this->allocateMemory(requirements.size, allocation.memoryType, &allocation.mapped);
+    this->dedicatedCounts[allocation.memoryType]++;
+    this->dedicatedSizes[allocation.memoryType] += requirements.size;
+    return allocation;
+  }
+
+  // With a granularity of 1, every resource can share the same blocks.
+  bool linear = resource != Resource::OPTIMAL_IMAGE || this->bufferImageGranularity == 1;
+  VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+
+  Block* block = nullptr;
+  for (const std::unique_ptr<Block> &candidate : this->blocks) {
+    if (candidate->memoryType != allocation.memoryType || candidate->linear != linear) continue;
+    if (candidate->allocate(requirements.size, alignment, allocation.node)) {
+      block = candidate.get();
+      break;
+    }
+  }
+
+  if (block == nullptr) {
+    this->blocks.push_back(std::make_unique<Block>(blockSize));
+    block = this->blocks.back().get();
+    block->memoryType = allocation.memoryType;
+    block->linear     = linear;
+    block->memory     = this->allocateMemory(blockSize, allocation.memoryType, &block->mapped);
+
+    if (!block->allocate(requirements.size, alignment, allocation.node)) {
+      throw std::runtime_error("Error: Failed to sub-allocate memory from a new block.\n");
+    }
+  }
+
+  allocation.block  = block;
+  allocation.memory = block->memory;
+  allocation.offset = block->nodes[allocation.node].offset;
+  if (block->mapped != nullptr) allocation.mapped = static_cast<char*>(block->mapped) + allocation.offset;
+
+  return allocation;
+}
+
+void MemoryAllocator::free(Allocation &allocation)
+{
+  if (allocation.memory == VK_NULL_HANDLE) return;
+
+  if (allocation.block == nullptr) {
+    this->freeMemory(allocation.memory, allocation.mapped != nullptr);
+    this->dedicatedCounts[allocation.memoryType]--;
+    this->dedicatedSizes[allocation.memoryType] -= allocation.size;
+    allocation = Allocation{};
+    return;
+  }
+
+  Block* block = allocation.block;
+  block->free(allocation.node);
+  allocation = Allocation{};
+
+  // Empty blocks go back to the driver, except the last one of their kind, so
+  // freeing and allocating again doesn't keep calling vkAllocateMemory.
+  if (block->allocationsCount > 0) return;
+
+  bool lastBlock = std::none_of(this->blocks.begin(), this->blocks.end(), [block](const std::unique_ptr<Block> &other) {
+    return other.get() != block && other->memoryType == block->memoryType && other->linear == block->linear;
+  });
+  if (lastBlock) return;
+
+  this->freeMemory(block->memory, block->mapped != nullptr);
+  this->blocks.erase(std::find_if(this->blocks.begin(), this->blocks.end(), [block](const std::unique_ptr<Block> &other) {
+    return other.get() == block;
+  }));
+}
+
+// An eighth of small heaps, so integrated GPUs aren't filled by a few blocks.
+VkDeviceSize MemoryAllocator::getBlockSize(uint32_t memoryType) const
+{
+  VkDeviceSize heapSize = this->memoryProperties.memoryHeaps[this->memoryProperties.memoryTypes[memoryType].heapIndex].size;
+  return heapSize <= 1024ull * 1024 * 1024 ? alignUp(heapSize / 8, 32) : BLOCK_SIZE;
+}
+
+VkDeviceMemory MemoryAllocator::allocateMemory(VkDeviceSize size, uint32_t memoryType, void** mapped)
+{
+  if (this->allocationsCount >= this->maxAllocationsCount) {
+    throw std::runtime_error("Error: Reached maxMemoryAllocationCount.\n");
+  }
+
+  VkMemoryAllocateInfo allocInfo{};
+  allocInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocInfo.allocationSize  = size;
+  allocInfo.memoryTypeIndex = memoryType;
+
+  VkDeviceMemory memory;
+  if (vkAllocateMemory(cachedDevice, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+    throw std::runtime_error("Error: Failed to allocate device memory.\n");
+  }
+  this->allocationsCount++;
+
+  // Persistent mapping.
+  *mapped = nullptr;
+  if (this->memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+    vkMapMemory(cachedDevice, memory, 0, VK_WHOLE_SIZE, 0, mapped);
+  }
+
+  return memory;
+}
+
+void MemoryAllocator::freeMemory(VkDeviceMemory memory, bool mapped)
+{
+  if (mapped) vkUnmapMemory(cachedDevice, memory);
+  vkFreeMemory(cachedDevice, memory, nullptr);
+  this->allocationsCount--;
+}
+
+std::vector<MemoryAllocator::HeapStats> MemoryAllocator::getHeapStats() const
+{
+  std::vector<HeapStats> heapsStats(this->memoryProperties.memoryHeapCount);
+
+  for (const std::unique_ptr<Block> &block : this->blocks) {
+    HeapStats &stats = heapsStats[this->memoryProperties.memoryTypes[block->memoryType].heapIndex];
+    stats.blocksCount++;
+    stats.blocksSize       += block->size;
+    stats.allocationsCount += block->allocationsCount;
+    stats.usedSize         += block->usedSize;
+  }
+
+  for (uint32_t i = 0; i < this->memoryProperties.memoryTypeCount; i++) {
+    HeapStats &stats = heapsStats[this->memoryProperties.memoryTypes[i].heapIndex];
+    stats.dedicatedCount += this->dedicatedCounts[i];
+    stats.dedicatedSize  += this->dedicatedSizes[i];
+  }
+
+  return heapsStats;
+}
+
+void MemoryAllocator::printStats() const
+{
+  std::vector<HeapStats> heapsStats = this->getHeapStats();
+  for (uint32_t i = 0; i < heapsStats.size(); i++) {
+    const HeapStats &stats = heapsStats[i];
+    if (stats.blocksCount == 0 && stats.dedicatedCount == 0) continue;
+
+    bool deviceLocal = this->memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+    std::cout << "INFO: Memory heap " << i << (deviceLocal ? " (device local): " : ": ")
+              << stats.blocksCount << " block(s) of " << stats.blocksSize / (1024 * 1024) << " MiB with "
+              << stats.usedSize / 1024 << " KiB used by " << stats.allocationsCount << " resource(s), "
+              << stats.dedicatedCount << " dedicated allocation(s) of " << stats.dedicatedSize / 1024 << " KiB.\n";
+  }
+  std::cout << "INFO: " << this->allocationsCount << " of " << this->maxAllocationsCount
+            << " device memory allocations in use.\n";
+}
@@ -0,0 +1,283 @@
+#include "MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <limits>
+
+MeshOptimizer::CacheStats MeshOptimizer::analyzeVertexCache(const std::vector<uint32_t> &indices, size_t verticesCount)
+{
+  CacheStats stats{};
+  if (indices.size() < 3) return stats;
+
+  // A vertex is in the cache while fewer than ANALYZED_CACHE_SIZE misses happened since it was loaded.
+  std::vector<uint32_t> timestamps(verticesCount, 0);
+  std::vector<uint8_t> used(verticesCount, 0);
+  uint32_t time = ANALYZED_CACHE_SIZE + 1;
+  size_t misses = 0;
+  size_t usedCount = 0;
+
+  for (uint32_t index : indices) {
+    if (time - timestamps[index] > ANALYZED_CACHE_SIZE) {
+      timestamps[index] = time++;
+      misses++;
+    }
+    if (!used[index]) {
+      used[index] = 1;
+      usedCount++;
+    }
+  }
+
+  stats.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+  stats.atvr = static_cast<float>(misses) / static_cast<float>(usedCount);
+  return stats;
+}
+
+/**
+ * @brief Scores a vertex as in Forsyth's "Linear-Speed Vertex Cache
+ * Optimisation". Vertices used by the last triangle are slightly penalized so
+ * strips don't get too long, and vertices with few triangles left get a boost
+ * so they're finished and leave no lone triangles behind.
+ */
+float MeshOptimizer::getVertexScore(int32_t cachePosition, uint32_t remainingTriangles)
+{
+  if (remainingTriangles == 0) return -1.0f;
+
+  float score = 0.0f;
+  if (cachePosition >= 0) {
+    if (cachePosition < 3) {
+      score = 0.75f;
+    }
+    else {
+      float scale = 1.0f / (OPTIMIZED_CACHE_SIZE - 3);
+      score = std::pow(1.0f - (cachePosition - 3) * scale, 1.5f);
+    }
+  }
+
+  return score + 2.0f / std::sqrt(static_cast<float>(remainingTriangles));
+}
+
+void MeshOptimizer::optimizeVertexCache(std::vector<uint32_t> &indices, size_t verticesCount)
+{
+  size_t trianglesCount = indices.size() / 3;
+  if (trianglesCount == 0) return;
+
+  // Triangles around each vertex. The first remainingTriangles[v] of them aren't drawn yet.
+  std::vector<uint32_t> remainingTriangles(verticesCount, 0);
+  for (uint32_t index : indices) remainingTriangles[index]++;
+
+  std::vector<uint32_t> trianglesOffsets(verticesCount + 1, 0);
+  std::partial_sum(remainingTriangles.begin(), remainingTriangles.end(), trianglesOffsets.begin() + 1);
+
+  std::vector<uint32_t> triangles(indices.size());
+  std::vector<uint32_t> fillOffsets(trianglesOffsets.begin(), trianglesOffsets.end() - 1);
+  for (size_t i = 0; i < indices.size(); i++) triangles[fillOffsets[indices[i]]++] = static_cast<uint32_t>(i / 3);
+
+  std::vector<float> vertexScores(verticesCount);
+  std::vector<int32_t> cachePositions(verticesCount, -1);
+  for (size_t i = 0; i < verticesCount; i++) vertexScores[i] = getVertexScore(-1, remainingTriangles[i]);
+
+  std::vector<float> triangleScores(trianglesCount);
+  std::vector<uint8_t> emitted(trianglesCount, 0);
+  for (size_t i = 0; i < trianglesCount; i++) {
+    triangleScores[i] = vertexScores[indices[i * 3]] + vertexScores[indices[i * 3 + 1]] + vertexScores[indices[i * 3 + 2]];
+  }
+
+  uint32_t bestTriangle = static_cast<uint32_t>(std::max_element(triangleScores.begin(), triangleScores.end()) -
+                                                triangleScores.begin());
+  std::vector<uint32_t> cache, newCache;
+  cache.reserve(OPTIMIZED_CACHE_SIZE + 3);
+  newCache.reserve(OPTIMIZED_CACHE_SIZE + 3);
+  std::vector<uint32_t> result;
+  result.reserve(indices.size());
+  size_t nextTriangle = 0; // Triangles before it were all emitted.
+
+  for (size_t emittedCount = 0; emittedCount < trianglesCount; emittedCount++) {
+    // No triangle around the cache left, so it starts again from any triangle not emitted yet.
+    if (bestTriangle == std::numeric_limits<uint32_t>::max()) {
+      while (emitted[nextTriangle]) nextTriangle++;
+      bestTriangle = static_cast<uint32_t>(nextTriangle);
+    }
+
+    const uint32_t* triangle = &indices[bestTriangle * 3];
+    result.insert(result.end(), triangle, triangle + 3);
+    emitted[bestTriangle] = 1;
+
+    // The triangle's vertices go to the front of the cache.
+    newCache.assign(triangle, triangle + 3);
+    for (uint32_t vertex : cache) {
+      if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2]) newCache.push_back(vertex);
+    }
+
+    for (int i = 0; i < 3; i++) {
+      uint32_t vertex = triangle[i];
+      uint32_t* first = &triangles[trianglesOffsets[vertex]];
+      uint32_t* last = first + remainingTriangles[vertex] - 1;
+      std::iter_swap(std::find(first, last + 1, bestTriangle), last);
+      remainingTriangles[vertex]--;
+    }
+
+    // Vertices pushed out of the cache lose their position score.
+    for (size_t i = OPTIMIZED_CACHE_SIZE; i < newCache.size(); i++) {
+      cachePositions[newCache[i]] = -1;
+      vertexScores[newCache[i]] = getVertexScore(-1, remainingTriangles[newCache[i]]);
+    }
+    newCache.resize(std::min<size_t>(newCache.size(), OPTIMIZED_CACHE_SIZE));
+    std::swap(cache, newCache);
+
+    for (size_t i = 0; i < cache.size(); i++) {
+      cachePositions[cache[i]] = static_cast<int32_t>(i);
+      vertexScores[cache[i]] = getVertexScore(static_cast<int32_t>(i), remainingTriangles[cache[i]]);
+    }
+
+    // Only the triangles around the cache changed, so the next one is picked among them.
+    bestTriangle = std::numeric_limits<uint32_t>::max();
+    float bestScore = -std::numeric_limits<float>::infinity();
+    for (uint32_t vertex : cache) {
+      for (uint32_t i = 0; i < remainingTriangles[vertex]; i++) {
+        uint32_t t = triangles[trianglesOffsets[vertex] + i];
+        triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+        if (triangleScores[t] > bestScore) {
+          bestScore = triangleScores[t];
+          bestTriangle = t;
+        }
+      }
+    }
+  }
+
+  indices = std::move(result);
+}
+
+/**
+ * @brief Splits the triangles where the cache starts over (all three vertices
+ * miss), then splits those clusters again wherever the ACMR so far is already
+ * as good as the whole cluster's, give or take the threshold.
+ */
+std::vector<uint32_t> MeshOptimizer::findClusters(const std::vector<uint32_t> &indices, size_t verticesCount,
+                                                  float threshold)
+{
+  uint32_t trianglesCount = static_cast<uint32_t>(indices.size() / 3);
+  std::vector<uint32_t> timestamps(verticesCount, 0);
+  uint32_t time = ANALYZED_CACHE_SIZE + 1;
+
+  auto countMisses = [&](uint32_t triangle) {
+    uint32_t misses = 0;
+    for (int i = 0; i < 3; i++) {
+      uint32_t index = indices[triangle * 3 + i];
+      if (time - timestamps[index] > ANALYZED_CACHE_SIZE) {
+        timestamps[index] = time++;
+        misses++;
+      }
+    }
+    return misses;
+  };
+  // Every vertex misses again.
+  auto resetCache = [&]() { time += ANALYZED_CACHE_SIZE + 1; };
+
+  std::vector<uint32_t> hardClusters;
+  for (uint32_t t = 0; t < trianglesCount; t++) {
+    if (countMisses(t) == 3 || t == 0) hardClusters.push_back(t);
+  }
+  hardClusters.push_back(trianglesCount);
+
+  std::vector<uint32_t> clusters;
+  for (size_t i = 0; i + 1 < hardClusters.size(); i++) {
+    uint32_t start = hardClusters[i], end = hardClusters[i + 1];
+
+    resetCache();
+    uint32_t clusterMisses = 0;
+    for (uint32_t t = start; t < end; t++) clusterMisses += countMisses(t);
+    float clusterThreshold = threshold * clusterMisses / static_cast<float>(end - start);
+
+    resetCache();
+    clusters.push_back(start);
+    uint32_t softStart = start;
+    uint32_t misses = 0;
+    for (uint32_t t = start; t + 1 < end; t++) {
+      misses += countMisses(t);
+      if (misses / static_cast<float>(t - softStart + 1) <= clusterThreshold) {
+        clusters.push_back(t + 1);
+        softStart = t + 1;
+        misses = 0;
+        resetCache();
+      }
+    }
+  }
+
+  return clusters;
+}
+
+void MeshOptimizer::optimizeOverdraw(std::vector<uint32_t> &indices, const std::vector<Model::Vertex> &vertices,
+                                     float threshold)
+{
+  if (indices.size() < 3) return;
+
+  std::vector<uint32_t> clusters = findClusters(indices, vertices.size(), threshold);
+  clusters.push_back(static_cast<uint32_t>(indices.size() / 3));
+
+  // Area weighted centroid and normal of the mesh and of each cluster.
+  std::vector<glm::vec3> clustersCentroids(clusters.size() - 1, glm::vec3(0.0f));
+  std::vector<glm::vec3> clustersNormals(clusters.size() - 1, glm::vec3(0.0f));
+  glm::vec3 meshCentroid(0.0f);
+  float meshArea = 0.0f;
+
+  for (size_t i = 0; i + 1 < clusters.size(); i++) {
+    float clusterArea = 0.0f;
+    for (uint32_t t = clusters[i]; t < clusters[i + 1]; t++) {
+      const glm::vec3 &p0 = vertices[indices[t * 3]].pos;
+      const glm::vec3 &p1 = vertices[indices[t * 3 + 1]].pos;
+      const glm::vec3 &p2 = vertices[indices[t * 3 + 2]].pos;
+
+      glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+      float area = glm::length(normal);
+      glm::vec3 centroid = (p0 + p1 + p2) / 3.0f;
+
+      clustersCentroids[i] += centroid * area;
+      clustersNormals[i] += normal;
+      clusterArea += area;
+      meshCentroid += centroid * area;
+      meshArea += area;
+    }
+    if (clusterArea > 0.0f) clustersCentroids[i] /= clusterArea;
+  }
+  if (meshArea > 0.0f) meshCentroid /= meshArea;
+
+  // Clusters facing away from the mesh's center are usually in front of the others, so they're drawn first.
+  std::vector<float> sortKeys(clusters.size() - 1, 0.0f);
+  for (size_t i = 0; i < sortKeys.size(); i++) {
+    float normalLength = glm::length(clustersNormals[i]);
+    if (normalLength > 0.0f) {
+      sortKeys[i] = glm::dot(clustersCentroids[i] - meshCentroid, clustersNormals[i] / normalLength);
+    }
+  }
+
+  std::vector<uint32_t> order(sortKeys.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&sortKeys](uint32_t a, uint32_t b) {
+    return sortKeys[a] > sortKeys[b];
+  });
+
+  std::vector<uint32_t> result;
+  result.reserve(indices.size());
+  for (uint32_t cluster : order) {
+    result.insert(result.end(), indices.begin() + clusters[cluster] * 3, indices.begin() + clusters[cluster + 1] * 3);
+  }
+  indices = std::move(result);
+}
+
+void MeshOptimizer::optimizeVertexFetch(std::vector<Model::Vertex> &vertices, std::vector<uint32_t> &indices)
+{
+  std::vector<uint32_t> remap(vertices.size(), std::numeric_limits<uint32_t>::max());
+  std::vector<Model::Vertex> result;
+  result.reserve(vertices.size());
+
+  for (uint32_t &index : indices) {
+    if (remap[index] == std::numeric_limits<uint32_t>::max()) {
+      remap[index] = static_cast<uint32_t>(result.size());
+      result.push_back(vertices[index]);
+    }
+    index = remap[index];
+  }
+
+  vertices = std::move(result);
+}
@@ -0,0 +1,241 @@
+#include "MeshSimplifier.hpp"
+
+#include <unordered_map>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+
+void MeshSimplifier::Quadric::addPlane(const glm::vec3 &normal, float distance, double planeWeight)
+{
+  double a = normal.x, b = normal.y, c = normal.z, d = distance;
+
+  this->a2 += planeWeight * a * a;
+  this->b2 += planeWeight * b * b;
+  this->c2 += planeWeight * c * c;
+  this->d2 += planeWeight * d * d;
+  this->ab += planeWeight * a * b;
+  this->ac += planeWeight * a * c;
+  this->ad += planeWeight * a * d;
+  this->bc += planeWeight * b * c;
+  this->bd += planeWeight * b * d;
+  this->cd += planeWeight * c * d;
+  this->weight += planeWeight;
+}
+
+void MeshSimplifier::Quadric::add(const Quadric &other)
+{
+  this->a2 += other.a2;
+  this->b2 += other.b2;
+  this->c2 += other.c2;
+  this->d2 += other.d2;
+  this->ab += other.ab;
+  this->ac += other.ac;
+  this->ad += other.ad;
+  this->bc += other.bc;
+  this->bd += other.bd;
+  this->cd += other.cd;
+  this->weight += other.weight;
+}
+
+double MeshSimplifier::Quadric::evaluate(const glm::vec3 &point) const
+{
+  if (this->weight <= 0.0) return 0.0;
+
+  double x = point.x, y = point.y, z = point.z;
+  double error = this->a2 * x * x + this->b2 * y * y + this->c2 * z * z + this->d2
+               + 2.0 * (this->ab * x * y + this->ac * x * z + this->bc * y * z)
+               + 2.0 * (this->ad * x + this->bd * y + this->cd * z);
+
+  // Rounding can take it slightly below 0.
+  return std::max(error, 0.0) / this->weight;
+}
+
+std::vector<MeshSimplifier::Level> MeshSimplifier::simplify(const std::vector<Model::Vertex> &vertices,
+                                                            const std::vector<uint32_t> &indices, uint32_t levelsCount)
+{
+  std::vector<Level> levels;
+
+  // Vertices that only differ by their attributes share a position, and move together.
+  std::unordered_map<glm::vec3, uint32_t> positionsMap;
+  std::vector<uint32_t> positionIDs(vertices.size());
+  std::vector<uint32_t> wedgesCounts;
+  for (size_t i = 0; i < vertices.size(); i++) {
+    auto positionObj = positionsMap.emplace(vertices[i].pos, static_cast<uint32_t>(wedgesCounts.size()));
+    if (positionObj.second) wedgesCounts.push_back(0);
+
+    positionIDs[i] = positionObj.first->second;
+    wedgesCounts[positionIDs[i]]++;
+  }
+  size_t positionsCount = wedgesCounts.size();
+
+  // Triangles with a repeated position can't be seen and would only get in the way.
+  std::vector<uint32_t> current;
+  current.reserve(indices.size());
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    uint32_t p0 = positionIDs[indices[i]], p1 = positionIDs[indices[i + 1]], p2 = positionIDs[indices[i + 2]];
+    if (p0 == p1 || p1 == p2 || p2 == p0) continue;
+    current.insert(current.end(), { indices[i], indices[i + 1], indices[i + 2] });
+  }
+
+  // Seams, open borders and edges shared by more than two triangles are locked.
+  std::vector<uint8_t> locked(positionsCount, 0);
+  for (size_t i = 0; i < positionsCount; i++) locked[i] = wedgesCounts[i] > 1;
+
+  std::unordered_map<uint64_t, uint32_t> edgesCounts;
+  for (size_t i = 0; i < current.size(); i += 3) {
+    for (int j = 0; j < 3; j++) {
+      uint64_t p0 = positionIDs[current[i + j]], p1 = positionIDs[current[i + (j + 1) % 3]];
+      edgesCounts[std::min(p0, p1) << 32 | std::max(p0, p1)]++;
+    }
+  }
+  for (const auto &edgeObj : edgesCounts) {
+    if (edgeObj.second == 2) continue;
+    locked[edgeObj.first >> 32] = 1;
+    locked[edgeObj.first & 0xFFFFFFFFu] = 1;
+  }
+
+  std::vector<Quadric> quadrics(positionsCount);
+  for (size_t i = 0; i < current.size(); i += 3) {
+    const glm::vec3 &p0 = vertices[current[i]].pos;
+    const glm::vec3 &p1 = vertices[current[i + 1]].pos;
+    const glm::vec3 &p2 = vertices[current[i + 2]].pos;
+
+    glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+    float doubleArea = glm::length(normal);
+    if (doubleArea == 0.0f) continue;
+    normal /= doubleArea;
+
+    for (int j = 0; j < 3; j++) {
+      quadrics[positionIDs[current[i + j]]].addPlane(normal, -glm::dot(normal, p0), doubleArea * 0.5);
+    }
+  }
+
+  std::vector<uint32_t> trianglesOffsets(positionsCount + 1);
+  std::vector<uint32_t> triangles;
+  std::vector<Collapse> collapses;
+  std::vector<uint8_t> touched(positionsCount);
+  std::vector<uint32_t> remap(vertices.size());
+  double maxCost = 0.0;
+
+  for (uint32_t level = 0; level < levelsCount; level++) {
+    size_t previousCount = current.size();
+    size_t targetCount = previousCount / 6 * 3;
+
+    // Each pass collapses edges far enough apart that they don't change each
+    // other's triangles, cheapest first.
+    while (current.size() > targetCount) {
+      // Triangles around each position.
+      std::fill(trianglesOffsets.begin(), trianglesOffsets.end(), 0);
+      for (uint32_t index : current) trianglesOffsets[positionIDs[index] + 1]++;
+      std::partial_sum(trianglesOffsets.begin(), trianglesOffsets.end(), trianglesOffsets.begin());
+
+      triangles.resize(current.size());
+      std::vector<uint32_t> fillOffsets(trianglesOffsets.begin(), trianglesOffsets.end() - 1);
+      for (size_t i = 0; i < current.size(); i++) {
+        triangles[fillOffsets[positionIDs[current[i]]]++] = static_cast<uint32_t>(i / 3);
+      }
+
+      collapses.clear();
+      for (size_t i = 0; i < current.size(); i += 3) {
+        for (int j = 0; j < 3; j++) {
+          uint32_t v0 = current[i + j], v1 = current[i + (j + 1) % 3];
+          for (const auto &edge : { std::make_pair(v0, v1), std::make_pair(v1, v0) }) {
+            if (locked[positionIDs[edge.first]]) continue;
+
+            Quadric quadric = quadrics[positionIDs[edge.first]];
+            quadric.add(quadrics[positionIDs[edge.second]]);
+            collapses.push_back({ edge.first, edge.second, quadric.evaluate(vertices[edge.second].pos) });
+          }
+        }
+      }
+      std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) {
+        return a.cost < b.cost;
+      });
+
+      std::fill(touched.begin(), touched.end(), 0);
+      std::iota(remap.begin(), remap.end(), 0);
+      size_t trianglesToRemove = (current.size() - targetCount) / 3;
+      size_t removedTriangles = 0;
+      size_t collapsesCount = 0;
+
+      for (const Collapse &collapse : collapses) {
+        uint32_t from = positionIDs[collapse.from], to = positionIDs[collapse.to];
+        if (touched[from] || touched[to]) continue;
+        if (flipsTriangles(collapse.from, collapse.to, current, positionIDs, vertices, trianglesOffsets, triangles)) continue;
+
+        // Every triangle around the moved vertex changes, so its whole ring is left alone until the next pass.
+        for (uint32_t k = trianglesOffsets[from]; k < trianglesOffsets[from + 1]; k++) {
+          size_t triangle = triangles[k] * 3;
+          bool hasTo = false;
+          for (int j = 0; j < 3; j++) {
+            touched[positionIDs[current[triangle + j]]] = 1;
+            hasTo |= positionIDs[current[triangle + j]] == to;
+          }
+          if (hasTo) removedTriangles++;
+        }
+
+        // The moved vertex isn't on a seam, so it's the only vertex at its position.
+        remap[collapse.from] = collapse.to;
+        quadrics[to].add(quadrics[from]);
+        maxCost = std::max(maxCost, collapse.cost);
+        collapsesCount++;
+
+        if (removedTriangles >= trianglesToRemove) break;
+      }
+
+      if (collapsesCount == 0) break;
+
+      size_t writeIndex = 0;
+      for (size_t i = 0; i < current.size(); i += 3) {
+        uint32_t v0 = remap[current[i]], v1 = remap[current[i + 1]], v2 = remap[current[i + 2]];
+        uint32_t p0 = positionIDs[v0], p1 = positionIDs[v1], p2 = positionIDs[v2];
+        if (p0 == p1 || p1 == p2 || p2 == p0) continue;
+
+        current[writeIndex++] = v0;
+        current[writeIndex++] = v1;
+        current[writeIndex++] = v2;
+      }
+      current.resize(writeIndex);
+    }
+
+    if (current.empty() || current.size() > previousCount * MIN_REDUCTION) break;
+    levels.push_back({ current, static_cast<float>(std::sqrt(maxCost)) });
+  }
+
+  return levels;
+}
+
+/**
+ * @brief Tells if moving from onto to would turn any of the triangles around
+ * from over, or fold it too much. The ones that also have to are removed by
+ * the collapse, so they're skipped.
+ */
+bool MeshSimplifier::flipsTriangles(uint32_t from, uint32_t to, const std::vector<uint32_t> &indices,
+                                    const std::vector<uint32_t> &positionIDs, const std::vector<Model::Vertex> &vertices,
+                                    const std::vector<uint32_t> &trianglesOffsets, const std::vector<uint32_t> &triangles)
+{
+  uint32_t fromPosition = positionIDs[from], toPosition = positionIDs[to];
+
+  for (uint32_t k = trianglesOffsets[fromPosition]; k < trianglesOffsets[fromPosition + 1]; k++) {
+    size_t triangle = triangles[k] * 3;
+
+    glm::vec3 positions[3];
+    bool hasTo = false;
+    for (int j = 0; j < 3; j++) {
+      positions[j] = vertices[indices[triangle + j]].pos;
+      hasTo |= positionIDs[indices[triangle + j]] == toPosition;
+    }
+    if (hasTo) continue;
+
+    glm::vec3 before = glm::cross(positions[1] - positions[0], positions[2] - positions[0]);
+    for (int j = 0; j < 3; j++) {
+      if (positionIDs[indices[triangle + j]] == fromPosition) positions[j] = vertices[to].pos;
+    }
+    glm::vec3 after = glm::cross(positions[1] - positions[0], positions[2] - positions[0]);
+
+    // More than about 75 degrees, or a triangle with no area left.
+    if (glm::dot(before, after) <= 0.25f * glm::length(before) * glm::length(after)) return true;
+  }
+
+  return false;
+}
@@ -0,0 +1,138 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+namespace {
+  thread_local size_t currentThreadIndex = 0;
+}
+
+ThreadPool::ThreadPool(size_t threadsCount)
+{
+  for (size_t i = 0; i < threadsCount; i++) {
+    workers.emplace_back(&ThreadPool::workerLoop, this, i + 1);
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(tasksMutex);
+    stopping = true;
+  }
+  tasksCondition.notify_all();
+
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+}
+
+void ThreadPool::workerLoop(size_t threadIndex)
+{
+  currentThreadIndex = threadIndex;
+
+  while (true) {
+    Task task;
+    {
+      std::unique_lock<std::mutex> lock(tasksMutex);
+      tasksCondition.wait(lock, [this] { return stopping || !tasks.empty(); });
+
+      if (stopping && tasks.empty()) return;
+
+      task = std::move(tasks.front());
+      tasks.pop_front();
+    }
+
+    this->runTask(task);
+  }
+}
+
+bool ThreadPool::tryRunTask()
+{
+  Task task;
+  {
+    std::lock_guard<std::mutex> lock(tasksMutex);
+    if (tasks.empty()) return false;
+
+    task = std::move(tasks.front());
+    tasks.pop_front();
+  }
+
+  this->runTask(task);
+  return true;
+}
+
+void ThreadPool::runTask(Task &task)
+{
+  try {
+    task.function();
+  }
+  catch (...) {
+    std::lock_guard<std::mutex> lock(task.group->exceptionMutex);
+    if (!task.group->exception) task.group->exception = std::current_exception();
+  }
+
+  // Under the lock, so a thread about to wait on the group can't miss the notification.
+  std::lock_guard<std::mutex> lock(task.group->doneMutex);
+  if (--task.group->pending == 0) task.group->doneCondition.notify_all();
+}
+
+void ThreadPool::submit(TaskGroup &group, std::function<void()> task)
+{
+  group.pending++;
+  {
+    std::lock_guard<std::mutex> lock(tasksMutex);
+    tasks.push_back({ std::move(task), &group });
+  }
+  tasksCondition.notify_one();
+}
+
+void ThreadPool::wait(TaskGroup &group)
+{
+  while (group.pending > 0) {
+    // Help instead of blocking. The queued task may belong to another group, which is fine.
+    if (this->tryRunTask()) continue;
+
+    // Nothing left to help with, so sleep until the group's last task finishes.
+    std::unique_lock<std::mutex> lock(group.doneMutex);
+    group.doneCondition.wait(lock, [&group] { return group.pending == 0; });
+  }
+  // The last task may still be notifying, so don't let the group be destroyed before it is done.
+  { std::lock_guard<std::mutex> lock(group.doneMutex); }
+
+  if (group.exception) {
+    std::exception_ptr exception = group.exception;
+    group.exception = nullptr;
+    std::rethrow_exception(exception);
+  }
+}
+
+void ThreadPool::parallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)> &func)
+{
+  grainSize = std::max<size_t>(grainSize, 1);
+
+  // Not worth a round trip through the queue.
+  if (count <= grainSize) {
+    if (count > 0) func(0, count);
+    return;
+  }
+
+  TaskGroup group;
+  for (size_t begin = 0; begin < count; begin += grainSize) {
+    size_t end = std::min(begin + grainSize, count);
+    this->submit(group, [&func, begin, end] { func(begin, end); });
+  }
+
+  this->wait(group);
+}
+
+// Getters and Setters
+
+size_t ThreadPool::getThreadsCount()
+{
+  return this->workers.size();
+}
+
+size_t ThreadPool::getThreadIndex()
+{
+  return currentThreadIndex;
+}
@@ -4,9 +4,9 @@
 
 void Utils::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, 
                     VkMemoryPropertyFlags properties, VkBuffer& buffer, 
-                    VkDeviceMemory& bufferMemory,
+                    MemoryAllocator::Allocation& bufferAllocation,
                     VkDevice device,
-                    VkPhysicalDevice physicalDevice)
+                    MemoryAllocator& allocator)
 {
   VkBufferCreateInfo bufferInfo{};
   bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -27,18 +27,18 @@ void Utils::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
   VkMemoryRequirements memRequirements;
   vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
 
-  // Memory allocation.
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties, physicalDevice);
-
-  if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-      throw std::runtime_error("Error: Failed to allocate buffer memory.\n");
-  }
+  // Memory allocation, carved out of one of the allocator's blocks.
+  bufferAllocation = allocator.allocate(memRequirements, properties, MemoryAllocator::Resource::BUFFER);
 
   // If memory allocation was successful, then we can now associate this memory with the buffer using.
-  vkBindBufferMemory(device, buffer, bufferMemory, 0);
+  vkBindBufferMemory(device, buffer, bufferAllocation.memory, bufferAllocation.offset);
+}
+
+void Utils::destroyBuffer(VkDevice device, VkBuffer buffer, MemoryAllocator::Allocation& bufferAllocation,
+                          MemoryAllocator& allocator)
+{
+  vkDestroyBuffer(device, buffer, nullptr);
+  allocator.free(bufferAllocation);
 }
 
 /**
@@ -158,11 +158,11 @@ VkImageView Utils::createImageView(VkDevice device, VkImage image, VkFormat form
   return imageView;
 }
 
-void Utils::createImage(VkDevice device, VkPhysicalDevice physicalDevice,
+void Utils::createImage(VkDevice device, MemoryAllocator& allocator,
                  uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits msaaSamples, VkFormat format, 
                  VkImageTiling tiling, VkImageUsageFlags usage, 
                  VkMemoryPropertyFlags properties, VkImage& image, 
-                 VkDeviceMemory& imageMemory)
+                 MemoryAllocator::Allocation& imageAllocation)
 {
 
   VkImageCreateInfo imageInfo{};
@@ -202,17 +202,18 @@ void Utils::createImage(VkDevice device, VkPhysicalDevice physicalDevice,
   VkMemoryRequirements memRequirements;
   vkGetImageMemoryRequirements(device, image, &memRequirements);
 
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex = Utils::findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                                                    physicalDevice);
+  MemoryAllocator::Resource resource = tiling == VK_IMAGE_TILING_LINEAR ? MemoryAllocator::Resource::LINEAR_IMAGE
+                                                                        : MemoryAllocator::Resource::OPTIMAL_IMAGE;
+  imageAllocation = allocator.allocate(memRequirements, properties, resource);
 
-  if (vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-    throw std::runtime_error("failed to allocate image memory!");
-  }
+  vkBindImageMemory(device, image, imageAllocation.memory, imageAllocation.offset);
+}
 
-  vkBindImageMemory(device, image, imageMemory, 0);
+void Utils::destroyImage(VkDevice device, VkImage image, MemoryAllocator::Allocation& imageAllocation,
+                         MemoryAllocator& allocator)
+{
+  vkDestroyImage(device, image, nullptr);
+  allocator.free(imageAllocation);
 }
 
 // Handles image layout transitions.
@@ -222,7 +223,13 @@ void Utils::transitionImageLayout(VkDevice device, VkQueue graphicsQueue,
                                     VkImageLayout newLayout, uint32_t mipLevels)
 {
   VkCommandBuffer commandBuffer = Utils::beginSingleTimeCommands(device, commandPool);
+  Utils::recordImageLayoutTransition(commandBuffer, image, format, oldLayout, newLayout, mipLevels);
+  Utils::endSingleTimeCommands(device, graphicsQueue, commandPool, commandBuffer);
+}
 
+void Utils::recordImageLayoutTransition(VkCommandBuffer commandBuffer, VkImage image, VkFormat format,
+                                        VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels)
+{
   // Use pipeline barrier like that is generally used to synchronize access to resources.
   // NOTE: We can use this barrier to transfer queue family ownership when VK_SHARING_MODE_EXCLUSIVE is used. 
   VkImageMemoryBarrier barrier{};
@@ -280,6 +287,14 @@ void Utils::transitionImageLayout(VkDevice device, VkQueue graphicsQueue,
     sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
     destinationStage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
   }
+  // Storage images, written and read by compute shaders.
+  else if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_GENERAL) {
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    destinationStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+  }
   else {
     throw std::invalid_argument("Error: Unsupported layout transition.\n");
   }
@@ -292,8 +307,6 @@ void Utils::transitionImageLayout(VkDevice device, VkQueue graphicsQueue,
     0, nullptr,
     1, &barrier
   );
-
-  Utils::endSingleTimeCommands(device, graphicsQueue, commandPool, commandBuffer);
 }
 
 // Helper function that tells us if the chosen depth format contains a stencil component.